@@ -48,12 +48,19 @@
 #include <CGAL/Nef_3/SNC_indexed_items.h>
 #include <CGAL/convex_decomposition_3.h> 
 #include <CGAL/convex_hull_3.h>
+#include <CGAL/Unique_hash_map.h>
+#include <CGAL/Polygon_2.h>
+#include <CGAL/Polygon_with_holes_2.h>
+#include <CGAL/minkowski_sum_2.h>
+#include <CGAL/Small_side_angle_bisector_decomposition_2.h>
+#include <CGAL/Boolean_set_operations_2.h>
 
 // Brep Includes
 
 #include <gp.hxx>
 #include <gp_Pln.hxx>
 #include <gp_Ax2.hxx>
+#include <gp_Ax3.hxx>
 #include <gp_Circ.hxx>
 
 #include <TopoDS.hxx>
@@ -61,6 +68,7 @@
 #include <TopoDS_Face.hxx>
 #include <TopExp_Explorer.hxx>
 #include <Poly_Triangulation.hxx>
+#include <TColgp_Array1OfPnt.hxx>
 
 #include <Bnd_Box.hxx>
 #include <BRepBndLib.hxx>
@@ -100,6 +108,15 @@
 #include <BRepBuilderAPI_MakeSolid.hxx>
 #include <BRepBuilderAPI_Transform.hxx>
 #include <BRepOffsetAPI_Sewing.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRep_Builder.hxx>
+#include <BRepTools.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopoDS_Shell.hxx>
+#include <TopoDS_Solid.hxx>
+#include <Precision.hxx>
 
 #include "ShapeAnalysis_ShapeTolerance.hxx"
 #include "ShapeAnalysis_ShapeContents.hxx"
@@ -115,8 +132,10 @@
 #include "ShapeFix.hxx"
 #include "ShapeFix_FixSmallFace.hxx"
 #include "BRepAlgoAPI_Fuse.hxx"
+#include <TopTools_ListOfShape.hxx>
 
 #include <PrintUtils.h>
+#include <ReadWrite.h>
 #include <BrepCgal.h>
 
 #include <boost/foreach.hpp>
@@ -127,6 +146,18 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <deque>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Threads 
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 // Math
 #include <math.h>
@@ -145,56 +176,594 @@ typedef Polyhedron::Halfedge_handle    Halfedge_handle;
 typedef Polyhedron::Facet_handle       Facet_handle;
 typedef Polyhedron::Vertex_handle      Vertex_handle;
 
+typedef CGAL::Polygon_2<Kernel> Polygon_2; 
+typedef CGAL::Polygon_with_holes_2<Kernel> Polygon_with_holes_2; 
+
+typedef CGAL::Epick Hull_kernel;
+typedef CGAL::Polyhedron_3<Hull_kernel> Hull_polyhedron;
+typedef Hull_kernel::Point_3 Hull_point;
+typedef CGAL::Surface_mesh<Hull_point> Hull_mesh;
+
 // Auxiliary tools
 namespace
 {
-  // Tool to get triangles from triangulation taking into account face
-  // orientation and location
-  class TriangleAccessor
+  // Vertices of a convex part as points on the hull kernel
+  template <typename Poly>
+  void PartPoints (const Poly& thePoly, std::vector<Hull_point>& thePoints)
+  {
+    thePoints.clear();
+    thePoints.reserve (thePoly.size_of_vertices());
+    for (typename Poly::Vertex_const_iterator aVert = thePoly.vertices_begin(); aVert != thePoly.vertices_end(); ++aVert)
+    {
+      const typename Poly::Point_3& aPnt = aVert->point();
+      thePoints.push_back (Hull_point (CGAL::to_double (aPnt[0]), CGAL::to_double (aPnt[1]), CGAL::to_double (aPnt[2])));
+    }
+  }
+
+  // Vertices of a surface mesh, already on the hull kernel
+  void MeshPoints (const Hull_mesh& theMesh, std::vector<Hull_point>& thePoints)
+  {
+    thePoints.clear();
+    thePoints.reserve (theMesh.number_of_vertices());
+    for (Hull_mesh::Vertex_iterator aVert = theMesh.vertices_begin(); aVert != theMesh.vertices_end(); ++aVert)
+      thePoints.push_back (theMesh.point (*aVert));
+  }
+
+  // Buffers one hull worker reuses from pair to pair
+  struct HullScratch
+  {
+    std::vector<Hull_point> mySum;
+    std::vector<Hull_point> myStrict;
+    std::vector<int>        mySeen;
+    std::vector<int>        myQueue;
+  };
+
+  // Hull of the summed points in the scratch. Vertices of the first hull
+  // lying inside one of its facets or edges are dropped and the rest hulled
+  // again, so the part comes out with only its corners.
+  bool HullSum (HullScratch& theScratch, Hull_polyhedron& theResult)
+  {
+    std::vector<Hull_point>& aSum = theScratch.mySum;
+    if (aSum.size() <= 3)
+      return false;
+
+    theResult.clear();
+    CGAL::convex_hull_3 (aSum.begin(), aSum.end(), theResult);
+
+    std::vector<Hull_point>& aStrict = theScratch.myStrict;
+    aStrict.clear();
+    for (Hull_polyhedron::Vertex_iterator aVert = theResult.vertices_begin(); aVert != theResult.vertices_end(); ++aVert)
+    {
+      const Hull_point& p = aVert->point();
+      Hull_polyhedron::Halfedge_handle h = aVert->halfedge(), e = h;
+      bool isCollinear = false;
+      bool isCoplanar = true;
+      do
+      {
+        const Hull_point& q = h->opposite()->vertex()->point();
+        if (isCoplanar && !CGAL::coplanar (p, q,
+              h->next_on_vertex()->opposite()->vertex()->point(),
+              h->next_on_vertex()->next_on_vertex()->opposite()->vertex()->point()))
+          isCoplanar = false;
+        for (Hull_polyhedron::Halfedge_handle j = h->next_on_vertex();
+             j != h && !isCollinear && !isCoplanar; j = j->next_on_vertex())
+        {
+          if (CGAL::collinear (p, q, j->opposite()->vertex()->point()))
+            isCollinear = true;
+        }
+        h = h->next_on_vertex();
+      }
+      while (h != e && !isCollinear);
+      if (!isCollinear && !isCoplanar)
+        aStrict.push_back (p);
+    }
+    if (aStrict.size() > 3)
+    {
+      theResult.clear();
+      CGAL::convex_hull_3 (aStrict.begin(), aStrict.end(), theResult);
+    }
+    return true;
+  }
+
+  // Hull of the Minkowski sum of two convex point sets, summing every pair
+  bool HullPair (const std::vector<Hull_point>& theA, const std::vector<Hull_point>& theB,
+                 HullScratch& theScratch, Hull_polyhedron& theResult)
+  {
+    std::vector<Hull_point>& aSum = theScratch.mySum;
+    aSum.clear();
+    aSum.reserve (theA.size() * theB.size());
+    for (size_t i = 0; i < theA.size(); i++)
+      for (size_t j = 0; j < theB.size(); j++)
+        aSum.push_back (theA[i] + (theB[j] - CGAL::ORIGIN));
+    return HullSum (theScratch, theResult);
+  }
+
+  // Bounding box of a non empty set of points
+  CGAL::Bbox_3 BoxOf (const std::vector<Hull_point>& thePoints)
+  {
+    CGAL::Bbox_3 aBox = thePoints.front().bbox();
+    for (size_t i = 1; i < thePoints.size(); i++)
+      aBox = aBox + thePoints[i].bbox();
+    return aBox;
+  }
+
+  typedef Hull_kernel::Vector_3 Hull_vector;
+
+  // A convex part as its hull: the extreme points, the vertices next to each
+  // and the outward normals of the facets around each, in order around the
+  // vertex, which span its normal cone. Flat parts have no cones and only
+  // keep their extreme points.
+  struct ConvexPart
+  {
+    std::vector<Hull_point>                myPoints;
+    std::vector<std::vector<int> >         myNeighbours;
+    std::vector<std::vector<Hull_vector> > myCones;
+
+    bool IsSolid() const { return !myCones.empty(); }
+  };
+
+  void BuildPart (const std::vector<Hull_point>& thePoints, ConvexPart& thePart)
+  {
+    thePart.myPoints.clear();
+    thePart.myNeighbours.clear();
+    thePart.myCones.clear();
+    if (thePoints.size() < 4)
+    {
+      thePart.myPoints = thePoints;
+      return;
+    }
+    Hull_polyhedron aHull;
+    CGAL::convex_hull_3 (thePoints.begin(), thePoints.end(), aHull);
+    CGAL::Unique_hash_map<Hull_polyhedron::Vertex_const_handle, int> anIds (-1);
+    for (Hull_polyhedron::Vertex_const_iterator aVert = aHull.vertices_begin(); aVert != aHull.vertices_end(); ++aVert)
+    {
+      anIds[aVert] = (int )thePart.myPoints.size();
+      thePart.myPoints.push_back (aVert->point());
+    }
+    if (!aHull.is_closed())
+      return;
+
+    CGAL::Unique_hash_map<Hull_polyhedron::Facet_const_handle, Hull_vector> aNormals;
+    double aVolume = 0.0;
+    for (Hull_polyhedron::Facet_const_iterator aFacet = aHull.facets_begin(); aFacet != aHull.facets_end(); ++aFacet)
+    {
+      Hull_polyhedron::Halfedge_const_handle h = aFacet->halfedge();
+      const Hull_point& p = h->vertex()->point();
+      const Hull_point& q = h->next()->vertex()->point();
+      const Hull_point& r = h->next()->next()->vertex()->point();
+      aVolume += CGAL::determinant (p - CGAL::ORIGIN, q - CGAL::ORIGIN, r - CGAL::ORIGIN) / 6.0;
+      Hull_vector n = CGAL::cross_product (q - p, r - p);
+      const double aLen = std::sqrt (n.squared_length());
+      aNormals[aFacet] = aLen > 0.0 ? n / aLen : n;
+    }
+    CGAL::Bbox_3 aBox = BoxOf (thePart.myPoints);
+    const double aSize = std::max (aBox.xmax() - aBox.xmin(), std::max (aBox.ymax() - aBox.ymin(), aBox.zmax() - aBox.zmin()));
+    if (aVolume <= 1e-12 * aSize * aSize * aSize)
+      return;
+
+    thePart.myNeighbours.resize (thePart.myPoints.size());
+    thePart.myCones.resize (thePart.myPoints.size());
+    for (Hull_polyhedron::Vertex_const_iterator aVert = aHull.vertices_begin(); aVert != aHull.vertices_end(); ++aVert)
+    {
+      const int anId = anIds[aVert];
+      Hull_polyhedron::Halfedge_around_vertex_const_circulator h = aVert->vertex_begin(), e = h;
+      do
+      {
+        thePart.myNeighbours[anId].push_back (anIds[h->opposite()->vertex()]);
+        thePart.myCones[anId].push_back (aNormals[h->facet()]);
+      }
+      while (++h != e);
+    }
+  }
+
+  // True if the plane through the origin with this normal strictly parts
+  // the two cones, one on each side
+  bool Separates (const Hull_vector& theAxis, const std::vector<Hull_vector>& theA, const std::vector<Hull_vector>& theB)
+  {
+    const double aLen = std::sqrt (theAxis.squared_length());
+    if (aLen <= 1e-12)
+      return false;
+    const Hull_vector anAxis = theAxis / aLen;
+    const double anEps = 1e-9;
+    double aMinA = anAxis * theA[0], aMaxA = aMinA, aMinB = anAxis * theB[0], aMaxB = aMinB;
+    for (size_t i = 1; i < theA.size(); i++) { const double d = anAxis * theA[i]; aMinA = std::min (aMinA, d); aMaxA = std::max (aMaxA, d); }
+    for (size_t j = 1; j < theB.size(); j++) { const double d = anAxis * theB[j]; aMinB = std::min (aMinB, d); aMaxB = std::max (aMaxB, d); }
+    return (aMinA > anEps && aMaxB < -anEps) || (aMaxA < -anEps && aMinB > anEps);
+  }
+
+  // Whether two normal cones may share a direction. They are only said to
+  // miss each other when a separating plane is found among the face planes
+  // of either cone and the planes through a ray of each, so any doubt
+  // keeps the pair.
+  bool ConesMeet (const std::vector<Hull_vector>& theA, const std::vector<Hull_vector>& theB)
+  {
+    for (size_t i = 0; i < theA.size(); i++)
+      if (Separates (CGAL::cross_product (theA[i], theA[(i + 1) % theA.size()]), theA, theB))
+        return false;
+    for (size_t j = 0; j < theB.size(); j++)
+      if (Separates (CGAL::cross_product (theB[j], theB[(j + 1) % theB.size()]), theA, theB))
+        return false;
+    for (size_t i = 0; i < theA.size(); i++)
+      for (size_t j = 0; j < theB.size(); j++)
+        if (Separates (CGAL::cross_product (theA[i], theB[j]), theA, theB))
+          return false;
+    return true;
+  }
+
+  // Vertex of a convex part furthest along a direction, climbing from a
+  // start vertex. On a convex polytope any local maximum is the maximum.
+  int Climb (const ConvexPart& thePart, int theStart, const Hull_vector& theDir)
+  {
+    int aBest = theStart;
+    double aBestDot = theDir * (thePart.myPoints[aBest] - CGAL::ORIGIN);
+    for (bool isMoved = true; isMoved; )
+    {
+      isMoved = false;
+      const std::vector<int>& aNext = thePart.myNeighbours[aBest];
+      for (size_t n = 0; n < aNext.size(); n++)
+      {
+        const double aDot = theDir * (thePart.myPoints[aNext[n]] - CGAL::ORIGIN);
+        if (aDot > aBestDot)
+        {
+          aBest = aNext[n];
+          aBestDot = aDot;
+          isMoved = true;
+          break;
+        }
+      }
+    }
+    return aBest;
+  }
+
+  // Hull of the Minkowski sum of two convex solids, summing only the vertex
+  // pairs whose normal cones meet, the pairs the Gaussian maps overlay. For
+  // each vertex of the first, the vertex of the second extreme inside its
+  // cone is found by climbing, then the vertices around it are taken for as
+  // long as their cones still meet. The cells met form a connected patch so
+  // the walk finds them all, and the work follows the size of the result
+  // instead of N x M.
+  bool GaussPair (const ConvexPart& theA, const ConvexPart& theB, HullScratch& theScratch, Hull_polyhedron& theResult)
+  {
+    std::vector<Hull_point>& aSum = theScratch.mySum;
+    std::vector<int>& aSeen = theScratch.mySeen;
+    std::vector<int>& aQueue = theScratch.myQueue;
+    aSum.clear();
+    aSeen.assign (theB.myPoints.size(), -1);
+    int aStart = 0;
+    for (size_t i = 0; i < theA.myPoints.size(); i++)
+    {
+      const std::vector<Hull_vector>& aCone = theA.myCones[i];
+      Hull_vector aDir = CGAL::NULL_VECTOR;
+      for (size_t c = 0; c < aCone.size(); c++)
+        aDir = aDir + aCone[c];
+      aStart = Climb (theB, aStart, aDir);
+      aSeen[aStart] = (int )i;
+      aQueue.assign (1, aStart);
+      while (!aQueue.empty())
+      {
+        const int b = aQueue.back();
+        aQueue.pop_back();
+        aSum.push_back (theA.myPoints[i] + (theB.myPoints[b] - CGAL::ORIGIN));
+        const std::vector<int>& aNext = theB.myNeighbours[b];
+        for (size_t n = 0; n < aNext.size(); n++)
+        {
+          if (aSeen[aNext[n]] == (int )i || !ConesMeet (aCone, theB.myCones[aNext[n]]))
+            continue;
+          aSeen[aNext[n]] = (int )i;
+          aQueue.push_back (aNext[n]);
+        }
+      }
+    }
+    return HullSum (theScratch, theResult);
+  }
+
+  // Minkowski hull of a pair of parts: through the Gaussian maps for two
+  // solids, otherwise by summing their extreme points
+  bool MinkowskiPair (const ConvexPart& theA, const ConvexPart& theB, HullScratch& theScratch, Hull_polyhedron& theResult)
+  {
+    if (theA.IsSolid() && theB.IsSolid())
+      return GaussPair (theA, theB, theScratch, theResult);
+    return HullPair (theA.myPoints, theB.myPoints, theScratch, theResult);
+  }
+
+  // Approximate convex decomposition for previews. The surface is cut in two
+  // by an axis aligned plane through the deepest point of the piece that
+  // lies furthest inside its own hull, until every piece is within the
+  // tolerance of its hull or the part budget is spent. Each half keeps the
+  // points where the plane cut it, so the hulls of the pieces still cover
+  // the whole solid.
+  class ApproximateDecomposer
+  {
+  public:
+    ApproximateDecomposer (int theMaxParts, double theConcavity)
+    : myMaxParts (std::max (1, theMaxParts)), myConcavity (theConcavity) {}
+
+    void Perform (const Hull_mesh& theMesh, std::vector<std::vector<Hull_point> >& theParts)
+    {
+      std::vector<Piece> aPieces (1);
+      for (Hull_mesh::Face_iterator aFace = theMesh.faces_begin(); aFace != theMesh.faces_end(); ++aFace)
+      {
+        Hull_mesh::Halfedge_index h = theMesh.halfedge (*aFace);
+        aPieces[0].myTris.push_back (theMesh.point (theMesh.source (h)));
+        aPieces[0].myTris.push_back (theMesh.point (theMesh.target (h)));
+        aPieces[0].myTris.push_back (theMesh.point (theMesh.target (theMesh.next (h))));
+      }
+      theParts.clear();
+      if (aPieces[0].myTris.empty())
+        return;
+      CGAL::Bbox_3 aBox = BoxOf (aPieces[0].myTris);
+      const double aTol = myConcavity * std::sqrt (CGAL::square (aBox.xmax() - aBox.xmin())
+                                                 + CGAL::square (aBox.ymax() - aBox.ymin())
+                                                 + CGAL::square (aBox.zmax() - aBox.zmin()));
+      measure (aPieces[0]);
+      while ((int )aPieces.size() < myMaxParts)
+      {
+        size_t aDeepest = 0;
+        for (size_t i = 1; i < aPieces.size(); i++)
+          if (aPieces[i].myDepth > aPieces[aDeepest].myDepth)
+            aDeepest = i;
+        if (aPieces[aDeepest].myDepth <= aTol)
+          break;
+        Piece aLow, aHigh;
+        if (!split (aPieces[aDeepest], aLow, aHigh))
+        {
+          aPieces[aDeepest].myDepth = 0.0; // cannot be split further
+          continue;
+        }
+        measure (aLow);
+        measure (aHigh);
+        aPieces[aDeepest] = aLow;
+        aPieces.push_back (aHigh);
+      }
+      theParts.resize (aPieces.size());
+      for (size_t i = 0; i < aPieces.size(); i++)
+        theParts[i].swap (aPieces[i].myHull);
+    }
+
+  private:
+    struct Piece
+    {
+      Piece() : myDepth (0.0) {}
+      std::vector<Hull_point> myTris;  // three points per triangle
+      std::vector<Hull_point> myHull;  // hull vertices
+      double                  myDepth; // how far the deepest point is inside the hull
+      Hull_point              myDeepest;
+    };
+
+    // Hull of a piece and its deepest point below the hull facets
+    static void measure (Piece& thePiece)
+    {
+      thePiece.myHull.clear();
+      thePiece.myDepth = 0.0;
+      thePiece.myDeepest = thePiece.myTris.front();
+      Hull_polyhedron aHull;
+      CGAL::convex_hull_3 (thePiece.myTris.begin(), thePiece.myTris.end(), aHull);
+      for (Hull_polyhedron::Vertex_iterator aVert = aHull.vertices_begin(); aVert != aHull.vertices_end(); ++aVert)
+        thePiece.myHull.push_back (aVert->point());
+      std::vector<Hull_kernel::Vector_3> aNormals;
+      std::vector<double> anOffsets;
+      for (Hull_polyhedron::Facet_iterator aFacet = aHull.facets_begin(); aFacet != aHull.facets_end(); ++aFacet)
+      {
+        Hull_polyhedron::Halfedge_handle h = aFacet->halfedge();
+        const Hull_point& p = h->vertex()->point();
+        Hull_kernel::Vector_3 n = CGAL::cross_product (h->next()->vertex()->point() - p,
+                                                       h->next()->next()->vertex()->point() - p);
+        const double aLen = std::sqrt (n.squared_length());
+        if (aLen <= 0.0)
+          continue;
+        n = n / aLen;
+        aNormals.push_back (n);
+        anOffsets.push_back (n * (p - CGAL::ORIGIN));
+      }
+      if (aNormals.empty())
+        return;
+      for (size_t i = 0; i < thePiece.myTris.size(); i++)
+      {
+        const Hull_kernel::Vector_3 v = thePiece.myTris[i] - CGAL::ORIGIN;
+        double aDepth = anOffsets[0] - aNormals[0] * v;
+        for (size_t f = 1; f < aNormals.size() && aDepth > thePiece.myDepth; f++)
+          aDepth = std::min (aDepth, anOffsets[f] - aNormals[f] * v);
+        if (aDepth > thePiece.myDepth)
+        {
+          thePiece.myDepth = aDepth;
+          thePiece.myDeepest = thePiece.myTris[i];
+        }
+      }
+    }
+
+    // Cut a piece across its longest side through its deepest point, kept
+    // away from the ends so both halves get a share
+    static bool split (const Piece& thePiece, Piece& theLow, Piece& theHigh)
+    {
+      CGAL::Bbox_3 aBox = BoxOf (thePiece.myTris);
+      int anAxis = 0;
+      for (int a = 1; a < 3; a++)
+        if (aBox.max (a) - aBox.min (a) > aBox.max (anAxis) - aBox.min (anAxis))
+          anAxis = a;
+      const double aLo = aBox.min (anAxis), aHi = aBox.max (anAxis);
+      if (aHi - aLo <= 0.0)
+        return false;
+      const double aCut = std::min (std::max (thePiece.myDeepest[anAxis], aLo + 0.1 * (aHi - aLo)), aHi - 0.1 * (aHi - aLo));
+      std::vector<Hull_point> aPoly, aLowPoly, aHighPoly;
+      for (size_t i = 0; i < thePiece.myTris.size(); i += 3)
+      {
+        aPoly.assign (thePiece.myTris.begin() + i, thePiece.myTris.begin() + i + 3);
+        clip (aPoly, anAxis, aCut, -1.0, aLowPoly);
+        clip (aPoly, anAxis, aCut,  1.0, aHighPoly);
+        fan (aLowPoly, theLow.myTris);
+        fan (aHighPoly, theHigh.myTris);
+      }
+      return !theLow.myTris.empty() && !theHigh.myTris.empty();
+    }
+
+    // Part of a polygon on one side of the plane x[theAxis] = theCut
+    static void clip (const std::vector<Hull_point>& thePoly, int theAxis, double theCut, double theSide,
+                      std::vector<Hull_point>& theOut)
+    {
+      theOut.clear();
+      for (size_t i = 0; i < thePoly.size(); i++)
+      {
+        const Hull_point& p = thePoly[i];
+        const Hull_point& q = thePoly[(i + 1) % thePoly.size()];
+        const double sp = theSide * (p[theAxis] - theCut), sq = theSide * (q[theAxis] - theCut);
+        if (sp >= 0.0)
+          theOut.push_back (p);
+        if ((sp > 0.0 && sq < 0.0) || (sp < 0.0 && sq > 0.0))
+          theOut.push_back (p + (q - p) * (sp / (sp - sq)));
+      }
+    }
+
+    // Triangles of a convex polygon
+    static void fan (const std::vector<Hull_point>& thePoly, std::vector<Hull_point>& theTris)
+    {
+      for (size_t i = 2; i < thePoly.size(); i++)
+      {
+        theTris.push_back (thePoly[0]);
+        theTris.push_back (thePoly[i - 1]);
+        theTris.push_back (thePoly[i]);
+      }
+    }
+
+  private:
+    int    myMaxParts;
+    double myConcavity;
+  };
+
+  // Points each shape gives a hull, cut down to the vertices of the shape's
+  // own hull. Planar faces bounded by straight edges only need their
+  // vertices, which are exact, and anything curved gives the nodes of its
+  // triangulation. Shapes are handed out to the threads through a counter.
+  class ExtremePoints
   {
   public:
-    TriangleAccessor (const TopoDS_Face& aFace)
+    ExtremePoints (const TopoDS_Shape* theShapes, int theNbShapes, std::vector<std::vector<Hull_point> >& thePoints)
+    : myShapes (theShapes), myNbShapes (theNbShapes), myPoints (thePoints), myNext (0), myFailed (false) {}
+
+    void operator() ()
     {
-      TopLoc_Location aLoc;
-      myPoly = BRep_Tool::Triangulation (aFace, aLoc);
-      myTrsf = aLoc.Transformation();
-      myNbTriangles = (myPoly.IsNull() ? 0 : myPoly->Triangles().Length());
-      myInvert = (aFace.Orientation() == TopAbs_REVERSED);
-      if (myTrsf.IsNegative())
-        myInvert = ! myInvert;
+      for (int i = myNext++; i < myNbShapes; i = myNext++)
+      {
+        try
+        {
+          if (!collect (myShapes[i], myPoints[i]))
+            myFailed = true;
+          else
+            prune (myPoints[i]);
+        }
+        catch (...)
+        {
+          myFailed = true;
+        }
+      }
     }
 
-    int NbTriangles () const { return myNbTriangles; } 
+    // true if a shape could not give all its points
+    bool Failed () const { return myFailed; }
 
-    // get i-th triangle and outward normal
-    void GetTriangle (int iTri, gp_Vec &theNormal, gp_Pnt &thePnt1, gp_Pnt &thePnt2, gp_Pnt &thePnt3)
+  private:
+    static bool collect (const TopoDS_Shape& theShape, std::vector<Hull_point>& thePoints)
     {
-      // get positions of nodes
-      int iNode1, iNode2, iNode3;
-      myPoly->Triangles()(iTri).Get (iNode1, iNode2, iNode3); 
-      thePnt1 = myPoly->Nodes()(iNode1);
-      thePnt2 = myPoly->Nodes()(myInvert ? iNode3 : iNode2);
-      thePnt3 = myPoly->Nodes()(myInvert ? iNode2 : iNode3);	
-
-      // apply transormation if not identity
-      if (myTrsf.Form() != gp_Identity)
+      for (TopExp_Explorer exp (theShape, TopAbs_VERTEX); exp.More(); exp.Next())
       {
-        thePnt1.Transform (myTrsf);
-        thePnt2.Transform (myTrsf);
-        thePnt3.Transform (myTrsf);
+        gp_Pnt aPnt = BRep_Tool::Pnt (TopoDS::Vertex (exp.Current()));
+        thePoints.push_back (Hull_point (aPnt.X(), aPnt.Y(), aPnt.Z()));
       }
+      for (TopExp_Explorer exp (theShape, TopAbs_FACE); exp.More(); exp.Next())
+      {
+        const TopoDS_Face& aFace = TopoDS::Face (exp.Current());
+        if (isStraightPlanar (aFace))
+          continue;
+        TopLoc_Location aLoc;
+        Handle(Poly_Triangulation) aPoly = BRep_Tool::Triangulation (aFace, aLoc);
+        if (aPoly.IsNull())
+          return false;
+        const gp_Trsf& aTrsf = aLoc.Transformation();
+        const TColgp_Array1OfPnt& aNodes = aPoly->Nodes();
+        for (int i = aNodes.Lower(); i <= aNodes.Upper(); i++)
+        {
+          gp_Pnt aPnt = aNodes (i);
+          if (aTrsf.Form() != gp_Identity)
+            aPnt.Transform (aTrsf);
+          thePoints.push_back (Hull_point (aPnt.X(), aPnt.Y(), aPnt.Z()));
+        }
+      }
+      return true;
+    }
 
-      // calculate normal
-      theNormal = (thePnt2.XYZ() - thePnt1.XYZ()) ^ (thePnt3.XYZ() - thePnt1.XYZ());
-      Standard_Real aNorm = theNormal.Magnitude();
-      if (aNorm > gp::Resolution()) theNormal /= aNorm;
+    static bool isStraightPlanar (const TopoDS_Face& theFace)
+    {
+      if (BRepAdaptor_Surface (theFace, Standard_False).GetType() != GeomAbs_Plane)
+        return false;
+      for (TopExp_Explorer exp (theFace, TopAbs_EDGE); exp.More(); exp.Next())
+      {
+        const TopoDS_Edge& anEdge = TopoDS::Edge (exp.Current());
+        if (!BRep_Tool::Degenerated (anEdge) && BRepAdaptor_Curve (anEdge).GetType() != GeomAbs_Line)
+          return false;
+      }
+      return true;
     }
 
+    static void prune (std::vector<Hull_point>& thePoints)
+    {
+      if (thePoints.size() < 4)
+        return;
+      Hull_polyhedron aHull;
+      CGAL::convex_hull_3 (thePoints.begin(), thePoints.end(), aHull);
+      if (aHull.size_of_vertices() < 3)
+        return;
+      thePoints.clear();
+      for (Hull_polyhedron::Vertex_iterator aVert = aHull.vertices_begin(); aVert != aHull.vertices_end(); ++aVert)
+        thePoints.push_back (aVert->point());
+    }
+
+  private:
+    const TopoDS_Shape*                      myShapes;
+    int                                      myNbShapes;
+    std::vector<std::vector<Hull_point> >&   myPoints;
+    std::atomic<int>                         myNext;
+    std::atomic<bool>                        myFailed;
+  };
+
+  // Hulls every pair of convex parts across a pool of threads. Pairs are
+  // handed out through a shared counter so uneven parts balance themselves,
+  // and each result lands in its own slot so no locking is needed.
+  class PairHuller
+  {
+  public:
+    PairHuller (const std::vector<ConvexPart>& theA,
+                const std::vector<ConvexPart>& theB,
+                std::vector<Hull_polyhedron>& theResults, std::vector<char>& theDone)
+    : myA (theA), myB (theB), myResults (theResults), myDone (theDone), myNext (0), myFailed (false) {}
+
+    void operator() ()
+    {
+      HullScratch aScratch;
+      const size_t aNbJobs = myA.size() * myB.size();
+      for (size_t aJob = myNext++; aJob < aNbJobs; aJob = myNext++)
+      {
+        try
+        {
+          myDone[aJob] = MinkowskiPair (myA[aJob / myB.size()], myB[aJob % myB.size()], aScratch, myResults[aJob]);
+        }
+        catch (...)
+        {
+          myDone[aJob] = 0;
+          myFailed = true;
+        }
+      }
+    }
+
+    // true if any pair threw. Pairs summing to three points or fewer are
+    // only skipped, they have no volume to lose.
+    bool Failed () const { return myFailed; }
+
   private:
-    Handle(Poly_Triangulation) myPoly;
-    gp_Trsf myTrsf;
-    int myNbTriangles;
-    bool myInvert;
+    const std::vector<ConvexPart>& myA;
+    const std::vector<ConvexPart>& myB;
+    std::vector<Hull_polyhedron>& myResults;
+    std::vector<char>& myDone;
+    std::atomic<size_t> myNext;
+    std::atomic<bool> myFailed;
   };
 
 
@@ -257,9 +826,10 @@ template <typename Polyhedron> bool createPolySetFromPolyhedron(const Polyhedron
 
 
 // ---------------------------------------------------------------------------------
-// export the result back out as Brep 
+// export the result back out as Brep, one face per triangle sewn together. 
+// Only used for polyhedra that are not closed. 
 // ---------------------------------------------------------------------------------
-template <typename Polyhedron> bool createBrepFromPolyhedron(const Polyhedron &p,TopoDS_Shape &aShape) {
+template <typename Polyhedron> bool sewBrepFromPolyhedron(const Polyhedron &p,TopoDS_Shape &aShape) {
 
 	//if (CGAL::Polygon_mesh_processing::is_outward_oriented(p)) {
 	//	PRINT("Polyhedron For Brep Conversion Is Closed");  
@@ -341,6 +911,169 @@ template <typename Polyhedron> bool createBrepFromPolyhedron(const Polyhedron &p
 	return err;
 }
 
+// ---------------------------------------------------------------------------------
+// Point of a polyhedron vertex as a gp point 
+// ---------------------------------------------------------------------------------
+template <typename Point> gp_Pnt toPnt(const Point &pt) { 
+	return gp_Pnt( CGAL::to_double( pt.x() ) , CGAL::to_double( pt.y() ) , CGAL::to_double( pt.z() ) ); 
+}
+
+// ---------------------------------------------------------------------------------
+// Newell normal of a facet, a loop of halfedges. Its length is twice the area. 
+// ---------------------------------------------------------------------------------
+template <typename Circulator> gp_Vec newell(Circulator h) { 
+	gp_Vec n( 0.0 , 0.0 , 0.0 ); 
+	Circulator e = h; 
+	do { 
+		gp_Pnt a = toPnt( h->opposite()->vertex()->point() ); 
+		gp_Pnt b = toPnt( h->vertex()->point() ); 
+		n += gp_Vec( ( a.Y() - b.Y() ) * ( a.Z() + b.Z() ) , 
+		             ( a.Z() - b.Z() ) * ( a.X() + b.X() ) , 
+		             ( a.X() - b.X() ) * ( a.Y() + b.Y() ) ); 
+	} while ( ++h != e ); 
+	return n; 
+}
+
+// ---------------------------------------------------------------------------------
+// Planar faced Brep of a closed polyhedron. Walks the halfedges once: facets 
+// lying in one plane are merged in to a single face, and each polyhedron 
+// vertex and edge becomes one Brep vertex and edge shared by the faces either 
+// side, so the shell is closed as built and needs no sewing. False if the 
+// polyhedron has degenerate facets or is not manifold. 
+// ---------------------------------------------------------------------------------
+template <typename Polyhedron> bool planarBrepFromPolyhedron(const Polyhedron &p,TopoDS_Shape &aShape) {
+	typedef typename Polyhedron::Vertex_const_handle                    VCH;
+	typedef typename Polyhedron::Halfedge_const_handle                  HCH;
+	typedef typename Polyhedron::Facet_const_handle                     FCH;
+	typedef typename Polyhedron::Vertex_const_iterator                  VCI;
+	typedef typename Polyhedron::Facet_const_iterator                   FCI;
+	typedef typename Polyhedron::Halfedge_around_facet_const_circulator HFCC;
+
+	const Standard_Real tolerance = Precision::Confusion(); 
+	BRep_Builder builder; 
+
+	// one Brep vertex per polyhedron vertex 
+	CGAL::Unique_hash_map<VCH,TopoDS_Vertex> vertices; 
+	for ( VCI vi = p.vertices_begin(); vi != p.vertices_end(); ++vi ) { 
+		TopoDS_Vertex v; 
+		builder.MakeVertex( v , toPnt( vi->point() ) , tolerance ); 
+		vertices[vi] = v; 
+	}
+
+	// flood facets in to regions lying in the plane of the region's first facet 
+	CGAL::Unique_hash_map<FCH,int> region( -1 ); 
+	std::vector<gp_Pln> planes; 
+	for ( FCI fi = p.facets_begin(); fi != p.facets_end(); ++fi ) { 
+		if ( region[fi] >= 0 ) continue; 
+		gp_Vec n = newell( fi->facet_begin() ); 
+		if ( n.Magnitude() <= gp::Resolution() ) return false; // degenerate facet 
+		gp_Pln plane( toPnt( fi->facet_begin()->vertex()->point() ) , gp_Dir( n ) ); 
+		int r = planes.size(); 
+		planes.push_back( plane ); 
+		region[fi] = r; 
+		std::vector<FCH> stack( 1 , fi ); 
+		while ( !stack.empty() ) { 
+			FCH f = stack.back(); 
+			stack.pop_back(); 
+			HFCC h = f->facet_begin(), e = h; 
+			do { 
+				FCH g = h->opposite()->facet(); 
+				if ( region[g] >= 0 ) continue; 
+				gp_Vec m = newell( g->facet_begin() ); 
+				if ( m.Magnitude() <= gp::Resolution() || gp_Dir( m ).Dot( plane.Axis().Direction() ) < 1.0 - 1e-9 ) continue; 
+				bool flat = true; 
+				HFCC gh = g->facet_begin(), ge = gh; 
+				do { 
+					if ( plane.Distance( toPnt( gh->vertex()->point() ) ) > tolerance ) flat = false; 
+				} while ( ++gh != ge && flat ); 
+				if ( !flat ) continue; 
+				region[g] = r; 
+				stack.push_back( g ); 
+			} while ( ++h != e ); 
+		}
+	}
+
+	// trace the boundary loops of each region, making each edge once for the 
+	// halfedge first met and using it reversed for the opposite halfedge 
+	CGAL::Unique_hash_map<HCH,TopoDS_Edge> edges; 
+	CGAL::Unique_hash_map<HCH,bool> traced( false ); 
+	std::vector<std::vector<TopoDS_Wire> > wires( planes.size() ); 
+	std::vector<std::vector<Standard_Real> > areas( planes.size() ); 
+	for ( FCI fi = p.facets_begin(); fi != p.facets_end(); ++fi ) { 
+		int r = region[fi]; 
+		HFCC h = fi->facet_begin(), e = h; 
+		do { 
+			HCH start = h; 
+			if ( traced[start] || region[start->opposite()->facet()] == r ) continue; 
+			TopoDS_Wire wire; 
+			builder.MakeWire( wire ); 
+			gp_Vec loopNormal( 0.0 , 0.0 , 0.0 ); 
+			HCH c = start; 
+			size_t steps = 0; 
+			do { 
+				traced[c] = true; 
+				if ( edges[c].IsNull() ) { 
+					TopoDS_Edge edge = BRepBuilderAPI_MakeEdge( vertices[c->opposite()->vertex()] , vertices[c->vertex()] ); 
+					edges[c] = edge; 
+					edges[c->opposite()] = TopoDS::Edge( edge.Reversed() ); 
+				}
+				builder.Add( wire , edges[c] ); 
+				gp_Pnt a = toPnt( c->opposite()->vertex()->point() ); 
+				gp_Pnt b = toPnt( c->vertex()->point() ); 
+				loopNormal += gp_Vec( ( a.Y() - b.Y() ) * ( a.Z() + b.Z() ) , 
+				                      ( a.Z() - b.Z() ) * ( a.X() + b.X() ) , 
+				                      ( a.X() - b.X() ) * ( a.Y() + b.Y() ) ); 
+				// next boundary halfedge, turning about the end vertex past interior ones 
+				HCH n = c->next(); 
+				while ( region[n->opposite()->facet()] == r ) n = n->opposite()->next(); 
+				c = n; 
+			} while ( c != start && ++steps <= p.size_of_halfedges() ); 
+			if ( c != start ) return false; // not manifold 
+			wire.Closed( Standard_True ); 
+			wires[r].push_back( wire ); 
+			areas[r].push_back( loopNormal.Dot( gp_Vec( planes[r].Axis().Direction() ) ) ); 
+		} while ( ++h != e ); 
+	}
+
+	// one face per region: its largest loop counter clockwise about the 
+	// outward normal bounds it, the others are holes 
+	TopoDS_Shell shell; 
+	builder.MakeShell( shell ); 
+	for ( size_t r = 0; r < planes.size(); r++ ) { 
+		if ( wires[r].empty() ) continue; 
+		size_t outer = std::max_element( areas[r].begin() , areas[r].end() ) - areas[r].begin(); 
+		BRepBuilderAPI_MakeFace face( planes[r] , wires[r][outer] , Standard_True ); 
+		for ( size_t w = 0; w < wires[r].size(); w++ ) { 
+			if ( w != outer ) face.Add( wires[r][w] ); 
+		}
+		if ( !face.IsDone() ) return false; 
+		builder.Add( shell , face.Face() ); 
+	}
+	shell.Closed( Standard_True ); 
+	TopoDS_Solid solid; 
+	builder.MakeSolid( solid ); 
+	builder.Add( solid , shell ); 
+	BRepLib::OrientClosedSolid( solid ); 
+	aShape = solid; 
+	return true; 
+}
+
+// ---------------------------------------------------------------------------------
+// export the result back out as Brep. Closed polyhedra are built planar 
+// faced directly, anything else is sewn from its triangles. 
+// ---------------------------------------------------------------------------------
+template <typename Polyhedron> bool createBrepFromPolyhedron(const Polyhedron &p,TopoDS_Shape &aShape) {
+	if ( !p.empty() && p.is_closed() ) { 
+		try { 
+			if ( planarBrepFromPolyhedron( p , aShape ) ) return false; 
+		}
+		catch(...) { 
+		}
+		PRINT("Planar Brep conversion failed, sewing triangles"); 
+	}
+	return sewBrepFromPolyhedron( p , aShape ); 
+}
+
 // -------------------------------------------------------------------------------------------------------------
 // Build a CGAL surface given coords and tris. 
 // Based on the http://jamesgregson.blogspot.com.au/2012/05/example-code-for-building.html 
@@ -371,266 +1104,808 @@ public:
 };
 
 // --------------------------------------------------------------
-// Convert a BREP in to a CGAL surface. Sure a more optimal way 
-// exists to do this. Classic issues with bad floating point 
-// and convexity. 
+// Convert a meshed BREP in to a CGAL surface mesh. Triangulation 
+// nodes are shared within each face and welded across faces 
+// along their common edges, so a closed solid comes out as a 
+// closed indexed mesh with no stitching afterwards. 
 // --------------------------------------------------------------
-template <typename Polyhedron> bool BrepCgal::BrepToCgal(TopoDS_Shape& aShape, Polyhedron& p) { 
-	std::vector<double> points;   
-	std::vector<double> nPoints;   
-	std::vector<int> nFaces;
-	typedef typename Polyhedron::Point_3  Point3;
-	// complete winding of points in triangle order. Every 9 values is a face. 
-	for (TopExp_Explorer exp (aShape , TopAbs_FACE); exp.More(); exp.Next())
-	{
-		TopoDS_Face face = TopoDS::Face (exp.Current());
-		TriangleAccessor aTool (face);
-		for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
-		{
-		 gp_Vec aNorm;
-	   gp_Pnt aPnt1, aPnt2, aPnt3;
-		 aTool.GetTriangle (iTri, aNorm, aPnt1, aPnt2, aPnt3);		
-		 Point3 a(aPnt1.X(),aPnt1.Y(),aPnt1.Z()); 
-		 Point3 b(aPnt2.X(),aPnt2.Y(),aPnt2.Z()); 
-		 Point3 c(aPnt3.X(),aPnt3.Y(),aPnt3.Z()); 
-		  if ( CGAL::squared_distance(a, b) != 0.0 ) { 
-		 		if ( CGAL::squared_distance(b, c) != 0.0 ) { 
-		 			if ( CGAL::squared_distance(c, a) != 0.0 ) { 
-						 points.push_back( aPnt1.X() ); points.push_back( aPnt1.Y() ); points.push_back( aPnt1.Z() );
-						 points.push_back( aPnt2.X() ); points.push_back( aPnt2.Y() ); points.push_back( aPnt2.Z() );
-		         points.push_back( aPnt3.X() ); points.push_back( aPnt3.Y() ); points.push_back( aPnt3.Z() ); 	
-					}	
-				}
-			}
+template <typename Mesh> bool BrepCgal::BrepToCgal(TopoDS_Shape& aShape, Mesh& mesh) { 
+	typedef typename Mesh::Point        Point; 
+	typedef typename Mesh::Vertex_index Vertex_index; 
+	std::vector<double> positions; 
+	std::vector<uint32_t> indices; 
+	ReadWrite welder; 
+	if ( !welder.WeldedMesh( aShape , positions , indices ) ) return false; 
+	mesh.clear(); 
+	mesh.reserve( positions.size() / 3 , indices.size() / 2 , indices.size() / 3 ); 
+	for ( size_t i = 0; i < positions.size(); i += 3 ) { 
+		mesh.add_vertex( Point( positions[i+0] , positions[i+1] , positions[i+2] ) ); 
+	}
+	std::vector<size_t> rejected; 
+	for ( size_t i = 0; i < indices.size(); i += 3 ) { 
+		if ( mesh.add_face( Vertex_index( indices[i+0] ) , Vertex_index( indices[i+1] ) , Vertex_index( indices[i+2] ) ) == Mesh::null_face() ) rejected.push_back( i ); 
+	}
+	if ( rejected.empty() ) return mesh.number_of_faces() > 0; 
+
+	// Triangles that would make a vertex or edge non manifold, typically at 
+	// seams and degenerated edges, go in on their own copies of their 
+	// corners and are stitched back along their edges. Only a mesh that is 
+	// still open after that fails. 
+	size_t dropped = 0; 
+	for ( size_t r = 0; r < rejected.size(); r++ ) { 
+		size_t i = rejected[r]; 
+		if ( indices[i+0] == indices[i+1] || indices[i+1] == indices[i+2] || indices[i+2] == indices[i+0] ) { 
+			dropped++; // no area to lose 
+			continue; 
+		}
+		Vertex_index corners[3]; 
+		for ( int c = 0; c < 3; c++ ) corners[c] = mesh.add_vertex( mesh.point( Vertex_index( indices[i+c] ) ) ); 
+		mesh.add_face( corners[0] , corners[1] , corners[2] ); 
+	}
+	CGAL::Polygon_mesh_processing::stitch_borders( mesh ); 
+	mesh.collect_garbage(); 
+	for ( typename Mesh::Halfedge_iterator h = mesh.halfedges_begin(); h != mesh.halfedges_end(); ++h ) { 
+		if ( mesh.is_border( *h ) ) { 
+			PRINT("BrepToCgal: mesh is still open after stitching non manifold triangles"); 
+			return false; 
 		}
 	}
-	for ( int i = 0; i < points.size()/3; i+=3 ) { 
-		nFaces.push_back( i + 0 ); nFaces.push_back( i + 1 ); nFaces.push_back( i + 2 );
+	std::stringstream output; 
+	output << "BrepToCgal: " << rejected.size() - dropped << " non manifold triangles stitched in, " << dropped << " degenerate left out"; 
+	PRINT( output.str() ); 
+	return mesh.number_of_faces() > 0; 
+}
+
+// --------------------------------------------------------------
+// Exact polyhedron with the vertices and faces of a surface mesh 
+// for the Nef code. The mesh has no removed elements so its 
+// indices run contiguously. 
+// --------------------------------------------------------------
+template <typename Mesh> void meshToPolyhedron(const Mesh &mesh, Polyhedron &p) { 
+	std::vector<double> coords; 
+	std::vector<int> tris; 
+	coords.reserve( mesh.number_of_vertices() * 3 ); 
+	tris.reserve( mesh.number_of_faces() * 3 ); 
+	for ( typename Mesh::Vertex_iterator v = mesh.vertices_begin(); v != mesh.vertices_end(); ++v ) { 
+		const typename Mesh::Point &pt = mesh.point( *v ); 
+		coords.push_back( pt.x() ); coords.push_back( pt.y() ); coords.push_back( pt.z() ); 
+	}
+	for ( typename Mesh::Face_iterator f = mesh.faces_begin(); f != mesh.faces_end(); ++f ) { 
+		typename Mesh::Halfedge_index h = mesh.halfedge( *f ), e = h; 
+		do { 
+			tris.push_back( (int)mesh.target( h ) ); 
+			h = mesh.next( h ); 
+		} while ( h != e ); 
 	}
-	surface_builder<HalfedgeDS> builder( points, nFaces );
+	surface_builder<HalfedgeDS> builder( coords , tris ); 
 	p.delegate( builder ); 
-	return true; 
 }
 
 // -------------------------------------------------------------------------------
-// Check if a Polyhedron is weakly convex. As per the OpenSCAD code. 
-// Did not implement the shell checking part yet. Do I need to?
+// Check if a closed surface mesh is convex on the filtered kernel. Every edge 
+// is tested with the orientation predicate against the far vertex of the 
+// face across it, allowing the far vertex to sit a hair above the plane so 
+// tessellated curved surfaces still pass. A mesh that is closed, connected 
+// and convex at every edge bounds a convex solid. 
 // ------------------------------------------------------------------------------- 
-bool is_weakly_convex(Polyhedron const& p) {
-	for (typename Polyhedron::Edge_const_iterator i = p.edges_begin(); i != p.edges_end(); ++i) {
-  	typename Polyhedron::Plane_3 p(i->opposite()->vertex()->point(), i->vertex()->point(), i->next()->vertex()->point());
-    if (p.has_on_positive_side(i->opposite()->next()->vertex()->point()) &&
-       CGAL::squared_distance(p, i->opposite()->next()->vertex()->point()) > 1e-8) {
-				PRINT("Was Weakly Convex");  
-     		return true;
- 		 }
+bool is_convex_mesh(const Hull_mesh &mesh) { 
+	if ( mesh.number_of_faces() == 0 ) return false; 
+	const double tolerance = 1e-8; 
+	for ( Hull_mesh::Halfedge_iterator hi = mesh.halfedges_begin(); hi != mesh.halfedges_end(); ++hi ) { 
+		Hull_mesh::Halfedge_index h = *hi; 
+		if ( mesh.is_border( h ) || mesh.is_border( mesh.opposite( h ) ) ) return false; 
+		const Hull_point &p = mesh.point( mesh.source( h ) ); 
+		const Hull_point &q = mesh.point( mesh.target( h ) ); 
+		const Hull_point &r = mesh.point( mesh.target( mesh.next( h ) ) ); 
+		const Hull_point &s = mesh.point( mesh.target( mesh.next( mesh.opposite( h ) ) ) ); 
+		if ( CGAL::orientation( p , q , r , s ) == CGAL::POSITIVE && 
+		     CGAL::squared_distance( Hull_kernel::Plane_3( p , q , r ) , s ) > tolerance ) return false; 
+	}
+	// one connected piece, two convex pieces apart are not convex together 
+	std::vector<char> seen( mesh.number_of_faces() , 0 ); 
+	std::vector<Hull_mesh::Face_index> stack( 1 , *mesh.faces_begin() ); 
+	seen[ *mesh.faces_begin() ] = 1; 
+	size_t reached = 1; 
+	while ( !stack.empty() ) { 
+		Hull_mesh::Halfedge_index h = mesh.halfedge( stack.back() ), e = h; 
+		stack.pop_back(); 
+		do { 
+			Hull_mesh::Face_index f = mesh.face( mesh.opposite( h ) ); 
+			if ( !seen[f] ) { 
+				seen[f] = 1; 
+				reached++; 
+				stack.push_back( f ); 
+			}
+			h = mesh.next( h ); 
+		} while ( h != e ); 
 	}
-  PRINT("Was Not Weakly Convex");  
-  return false; 
+	return reached == mesh.number_of_faces(); 
 }
 
 // -------------------------------------------------------------------------
-// Following the exising openscad code as guide. Generate hull. 
+// Convex decompositions already worked out, by hash of the tessellated 
+// operand. Kept in memory for the session and, if a directory is set, on 
+// disk as the vertex sets of the parts so they outlive it. 
 // -------------------------------------------------------------------------
-bool BrepCgal::hull( TopoDS_Shape *shapes, TopoDS_Shape &rShape ) {
-
-	rShape = shapes[0]; 
-
-	//const Geometry::Geometries &children, PolySet &result
-	/*typedef CGAL::Epick K;
-	// Collect point cloud
-	// NB! CGAL's convex_hull_3() doesn't like std::set iterators, so we use a list
-	// instead.
-	std::list<K::Point_3> points;
-	for(const auto &item : children) {
-		const shared_ptr<const Geometry> &chgeom = item.second;
-		const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(chgeom.get());
-		if (N) {
-			if (!N->isEmpty()) {
-				for (CGAL_Nef_polyhedron3::Vertex_const_iterator i = N->p3->vertices_begin(); i != N->p3->vertices_end(); ++i) {
-					points.push_back(vector_convert<K::Point_3>(i->point()));
-				}
-			}
-		} else {
-			const PolySet *ps = dynamic_cast<const PolySet *>(chgeom.get());
-			if (ps) {
-				for(const auto &p : ps->polygons) {
-					for(const auto &v : p) {
-						points.push_back(K::Point_3(v[0], v[1], v[2]));
-					}
-				}
-			}
+static const size_t DECOMPOSITION_CACHE_ENTRIES = 256; 
+static const char DECOMPOSITION_MAGIC[8] = { 'M','K','P','A','R','T','2','\0' }; 
+
+// Parts of a decomposition with the size of the mesh they came from, checked 
+// on a hit so a hash collision is not taken for the same operand 
+struct CachedParts { 
+	uint32_t vertices; 
+	uint32_t faces; 
+	std::vector<std::vector<Hull_point> > parts; 
+}; 
+static std::map<uint64_t,CachedParts> decompositions; 
+static std::string decompositionDir; 
+
+// Directory to keep decompositions in, NULL or empty for memory only 
+void BrepCgal::SetDecompositionCache(const char* dir) { 
+	decompositionDir = dir == NULL ? "" : dir; 
+}
+
+// -------------------------------------------------------------------------
+// Preview mode. With a part budget set, operands are decomposed 
+// approximately in bounded time instead of exactly through the Nef. 
+// -------------------------------------------------------------------------
+static int approximateParts = 0;            // 0 for the exact decomposition 
+static double approximateConcavity = 0.01;  // allowed depth, relative to the operand size 
+
+// Pick the approximate decomposition with at most maxParts parts, each no 
+// deeper than concavity times the operand's diagonal from its hull. A 
+// maxParts of zero goes back to the exact decomposition. 
+void BrepCgal::SetApproximate(int maxParts, double concavity) { 
+	approximateParts = std::max( 0 , maxParts ); 
+	approximateConcavity = std::max( 0.0 , concavity ); 
+}
+
+// -------------------------------------------------------------------------
+// Snap rounding. When a grid is set, operand coordinates are rounded to it 
+// just before the exact decomposition so the exact numbers the Nef works 
+// with start short. Off by default; a power of two grid is held exactly by 
+// doubles. Convex, approximate and cached operands are never snapped. 
+// -------------------------------------------------------------------------
+static double snapGrid = 0.0;  // 0 leaves coordinates as they are 
+
+void BrepCgal::SetSnapGrid(double grid) { 
+	snapGrid = std::max( 0.0 , grid ); 
+}
+
+static double snapped(double v) { 
+	return std::floor( v / snapGrid + 0.5 ) * snapGrid; 
+}
+
+static Hull_point snapped(const Hull_point &p) { 
+	return Hull_point( snapped( p.x() ) , snapped( p.y() ) , snapped( p.z() ) ); 
+}
+
+// Bits of mantissa a coordinate needs, a measure of how long its exact 
+// number will be 
+static int significantBits(double v) { 
+	if ( v == 0.0 ) return 0; 
+	int exponent; 
+	uint64_t mantissa = (uint64_t)ldexp( fabs( frexp( v , &exponent ) ) , 53 ); 
+	int bits = 53; 
+	while ( bits > 0 && !( mantissa & 1 ) ) { mantissa >>= 1; bits--; } 
+	return bits; 
+}
+
+static size_t significantBits(const Hull_point &p) { 
+	return significantBits( p.x() ) + significantBits( p.y() ) + significantBits( p.z() ); 
+}
+
+// Moves every vertex of a mesh on to the grid. The mesh is left as it is 
+// if that would merge vertices, flatten a face or make faces cross. 
+static bool snapMesh(Hull_mesh &mesh) { 
+	if ( snapGrid <= 0.0 ) return false; 
+	Hull_mesh result = mesh; 
+	std::map<Hull_point,int> seen; 
+	size_t moved = 0; 
+	size_t bitsBefore = 0; 
+	size_t bitsAfter = 0; 
+	for ( Hull_mesh::Vertex_iterator v = result.vertices_begin(); v != result.vertices_end(); ++v ) { 
+		Hull_point p = snapped( result.point( *v ) ); 
+		bitsBefore += significantBits( result.point( *v ) ); 
+		bitsAfter += significantBits( p ); 
+		if ( p != result.point( *v ) ) moved++; 
+		if ( !seen.insert( std::make_pair( p , 0 ) ).second ) { 
+			PRINT("Snap: grid merges vertices, left unsnapped"); 
+			return false; 
 		}
+		result.point( *v ) = p; 
+	}
+	if ( moved == 0 ) return false; 
+	for ( Hull_mesh::Face_iterator f = result.faces_begin(); f != result.faces_end(); ++f ) { 
+		Hull_mesh::Halfedge_index h = result.halfedge( *f ); 
+		if ( CGAL::collinear( result.point( result.target( h ) ) , 
+		                      result.point( result.target( result.next( h ) ) ) , 
+		                      result.point( result.source( h ) ) ) ) { 
+			PRINT("Snap: grid flattens a face, left unsnapped"); 
+			return false; 
+		}
+	}
+	if ( CGAL::Polygon_mesh_processing::does_self_intersect( result ) ) { 
+		PRINT("Snap: grid makes faces cross, left unsnapped"); 
+		return false; 
+	}
+	mesh = result; 
+	std::stringstream output; 
+	output << "Snap: " << moved << " of " << mesh.number_of_vertices() << " vertices moved, coordinate bits " 
+	       << bitsBefore << " -> " << bitsAfter; 
+	PRINT( output.str() ); 
+	return true; 
+}
+
+// Volume of a triangulated hull, zero for a flat one 
+static double hullVolume(const Hull_polyhedron &hull) { 
+	double volume = 0.0; 
+	for ( Hull_polyhedron::Facet_const_iterator f = hull.facets_begin(); f != hull.facets_end(); ++f ) { 
+		Hull_polyhedron::Halfedge_const_handle h = f->halfedge(); 
+		volume += CGAL::determinant( h->vertex()->point() - CGAL::ORIGIN , 
+		                             h->next()->vertex()->point() - CGAL::ORIGIN , 
+		                             h->next()->next()->vertex()->point() - CGAL::ORIGIN ) / 6.0; 
+	}
+	return volume; 
+}
+
+// Volume of the hull of a point set, leaving only the hull's corners 
+static double hullVolume(std::vector<Hull_point> &points) { 
+	if ( points.size() < 4 ) return 0.0; 
+	Hull_polyhedron hull; 
+	CGAL::convex_hull_3( points.begin() , points.end() , hull ); 
+	if ( hull.size_of_facets() == 0 ) return 0.0; 
+	points.clear(); 
+	for ( Hull_polyhedron::Vertex_const_iterator v = hull.vertices_begin(); v != hull.vertices_end(); ++v ) points.push_back( v->point() ); 
+	return hullVolume( hull ); 
+}
+
+// -------------------------------------------------------------------------
+// Part merging. Decompositions over split, a flat face often coming out as 
+// a row of thin slabs. Parts that touch and whose hull together is no 
+// bigger than the two of them, to a tolerance, are one convex part and are 
+// merged, greedily, until no pair is left. Each merge saves a hull job for 
+// every part of the other operand. Only exact decompositions are merged: 
+// approximate parts overlap, so the sum of their volumes says nothing. 
+// -------------------------------------------------------------------------
+static const double MERGE_TOLERANCE = 1e-5;  // of the merged volume 
+
+static bool boxesTouch(const CGAL::Bbox_3 &a , const CGAL::Bbox_3 &b , double slack) { 
+	return a.xmin() <= b.xmax() + slack && b.xmin() <= a.xmax() + slack && 
+	       a.ymin() <= b.ymax() + slack && b.ymin() <= a.ymax() + slack && 
+	       a.zmin() <= b.zmax() + slack && b.zmin() <= a.zmax() + slack; 
+}
+
+// Two parts queued for merging and their versions at the time 
+struct MergePair { 
+	size_t i , j; 
+	size_t versionI , versionJ; 
+	MergePair(size_t i , size_t j , size_t versionI , size_t versionJ) : i(i), j(j), versionI(versionI), versionJ(versionJ) {} 
+}; 
+
+static void mergeParts(std::vector<std::vector<Hull_point> > &parts) { 
+	if ( parts.size() < 2 ) return; 
+	size_t before = parts.size(); 
+	std::vector<double> volumes( parts.size() ); 
+	std::vector<CGAL::Bbox_3> boxes( parts.size() ); 
+	double size = 0.0; 
+	for ( size_t i = 0; i < parts.size(); i++ ) { 
+		volumes[i] = hullVolume( parts[i] ); 
+		boxes[i] = BoxOf( parts[i] ); 
+		size = std::max( size , std::max( boxes[i].xmax() - boxes[i].xmin() , 
+		                        std::max( boxes[i].ymax() - boxes[i].ymin() , boxes[i].zmax() - boxes[i].zmin() ) ) ); 
 	}
-	if (points.size() <= 3) return false;
-	// Apply hull
-	bool success = false;
-	if (points.size() >= 4) {
-		CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
-		try {
-			CGAL::Polyhedron_3<K> r;
-			CGAL::convex_hull_3(points.begin(), points.end(), r);
-     	PRINTDB("After hull vertices: %d", r.size_of_vertices());
-      PRINTDB("After hull facets: %d", r.size_of_facets());
-      PRINTDB("After hull closed: %d", r.is_closed());
-      PRINTDB("After hull valid: %d", r.is_valid());
-			success = !createPolySetFromPolyhedron(r, result);
+	double slack = std::max( snapGrid , 1e-9 * size ); 
+	// Worklist of touching pairs with the version of each part when the pair 
+	// was queued. A merge bumps the grown part's version, which makes its old 
+	// pairs stale, and queues it afresh against the live parts it now touches. 
+	std::vector<bool> alive( parts.size() , true ); 
+	std::vector<size_t> versions( parts.size() , 0 ); 
+	std::deque<MergePair> pending; 
+	for ( size_t i = 0; i < parts.size(); i++ ) { 
+		for ( size_t j = i + 1; j < parts.size(); j++ ) { 
+			if ( boxesTouch( boxes[i] , boxes[j] , slack ) ) pending.push_back( MergePair( i , j , 0 , 0 ) ); 
 		}
-		catch (const CGAL::Failure_exception &e) {
-			PRINTB("ERROR: CGAL error in applyHull(): %s", e.what());
+	}
+	try { 
+		while ( !pending.empty() ) { 
+			MergePair pair = pending.front(); 
+			pending.pop_front(); 
+			size_t i = pair.i; 
+			size_t j = pair.j; 
+			if ( !alive[i] || !alive[j] || versions[i] != pair.versionI || versions[j] != pair.versionJ ) continue; 
+			std::vector<Hull_point> both( parts[i] ); 
+			both.insert( both.end() , parts[j].begin() , parts[j].end() ); 
+			double volume = hullVolume( both ); 
+			if ( volume <= 0.0 ) continue; // flat pairs have no volume to compare 
+			if ( volume - volumes[i] - volumes[j] > MERGE_TOLERANCE * volume ) continue; 
+			parts[i].swap( both ); 
+			std::vector<Hull_point>().swap( parts[j] ); 
+			volumes[i] = volume; 
+			boxes[i] = boxes[i] + boxes[j]; 
+			alive[j] = false; 
+			versions[i]++; 
+			for ( size_t k = 0; k < parts.size(); k++ ) { 
+				if ( k == i || !alive[k] || !boxesTouch( boxes[i] , boxes[k] , slack ) ) continue; 
+				pending.push_back( MergePair( i , k , versions[i] , versions[k] ) ); 
+			}
 		}
-		CGAL::set_error_behaviour(old_behaviour);
 	}
-	return success;*/
+	catch(...) { 
+		PRINT("Minkowski: part merging stopped"); 
+	}
+	size_t kept = 0; 
+	for ( size_t i = 0; i < parts.size(); i++ ) { 
+		if ( !alive[i] ) continue; 
+		if ( kept != i ) parts[kept].swap( parts[i] ); 
+		kept++; 
+	}
+	parts.resize( kept ); 
+	if ( parts.size() == before ) return; 
+	std::stringstream output; 
+	output << "Minkowski: merged " << before << " parts in to " << parts.size(); 
+	PRINT( output.str() ); 
+}
+
+// 64 bit FNV-1a over a block of bytes, continuing from hash 
+static uint64_t fnv1a(uint64_t hash , const void *data , size_t size) { 
+	const unsigned char *bytes = (const unsigned char*)data; 
+	for ( size_t i = 0; i < size; i++ ) { hash ^= bytes[i]; hash *= 1099511628211ULL; }
+	return hash; 
+}
+
+// Hash of the coordinates and faces of a mesh. The mesh comes from the 
+// tessellation so this covers the mesh parameters as well. 
+static uint64_t meshHash(const Hull_mesh &mesh) { 
+	uint64_t hash = 14695981039346656037ULL; 
+	for ( Hull_mesh::Vertex_iterator v = mesh.vertices_begin(); v != mesh.vertices_end(); ++v ) { 
+		const Hull_point &p = mesh.point( *v ); 
+		double xyz[3] = { p.x() , p.y() , p.z() }; 
+		hash = fnv1a( hash , xyz , sizeof(xyz) ); 
+	}
+	for ( Hull_mesh::Face_iterator f = mesh.faces_begin(); f != mesh.faces_end(); ++f ) { 
+		Hull_mesh::Halfedge_index h = mesh.halfedge( *f ), e = h; 
+		do { 
+			uint32_t v = (uint32_t)mesh.target( h ); 
+			hash = fnv1a( hash , &v , sizeof(v) ); 
+			h = mesh.next( h ); 
+		} while ( h != e ); 
+	}
+	return hash; 
+}
+
+// Path of the cache file for a decomposition 
+static std::string decompositionPath(uint64_t key) { 
+	char name[32]; 
+	snprintf( name , sizeof(name) , "/%016llx.parts" , (unsigned long long)key ); 
+	return decompositionDir + name; 
+}
+
+// Look a decomposition up in memory, then on disk. The file holds the magic, 
+// the key, the vertex and face counts of the mesh, the part count, then for 
+// each part its vertex count and xyz doubles. 
+static bool cachedDecomposition(uint64_t key , const Hull_mesh &mesh , std::vector<std::vector<Hull_point> > &parts) { 
+	uint32_t vertices = mesh.number_of_vertices(); 
+	uint32_t faces = mesh.number_of_faces(); 
+	std::map<uint64_t,CachedParts>::const_iterator it = decompositions.find( key ); 
+	if ( it != decompositions.end() ) { 
+		if ( it->second.vertices != vertices || it->second.faces != faces ) return false; 
+		parts = it->second.parts; 
+		return true; 
+	}
+	if ( decompositionDir.empty() ) return false; 
+	std::ifstream file( decompositionPath( key ).c_str() , std::ios::binary ); 
+	char magic[sizeof(DECOMPOSITION_MAGIC)]; 
+	uint64_t fileKey = 0; 
+	uint32_t header[3] = { 0 , 0 , 0 }; 
+	if ( !file.read( magic , sizeof(magic) ) || memcmp( magic , DECOMPOSITION_MAGIC , sizeof(magic) ) != 0 || 
+	     !file.read( (char*)&fileKey , sizeof(fileKey) ) || !file.read( (char*)header , sizeof(header) ) || 
+	     fileKey != key || header[0] != vertices || header[1] != faces ) return false; 
+	CachedParts loaded; 
+	loaded.vertices = vertices; 
+	loaded.faces = faces; 
+	std::vector<double> xyz; 
+	for ( uint32_t i = 0; i < header[2]; i++ ) { 
+		uint32_t n = 0; 
+		if ( !file.read( (char*)&n , sizeof(n) ) ) return false; 
+		xyz.resize( n * 3 ); 
+		if ( n > 0 && !file.read( (char*)&xyz[0] , sizeof(double) * xyz.size() ) ) return false; 
+		loaded.parts.push_back( std::vector<Hull_point>() ); 
+		loaded.parts.back().reserve( n ); 
+		for ( uint32_t j = 0; j < n; j++ ) loaded.parts.back().push_back( Hull_point( xyz[j*3+0] , xyz[j*3+1] , xyz[j*3+2] ) ); 
+	}
+	if ( decompositions.size() >= DECOMPOSITION_CACHE_ENTRIES ) decompositions.clear(); 
+	decompositions[key] = loaded; 
+	parts.swap( loaded.parts ); 
 	return true; 
 }
 
+// Remember a decomposition in memory and on disk. The file is written under 
+// a name of its own and renamed in to place, so a reader never sees it part 
+// written. 
+static void cacheDecomposition(uint64_t key , const Hull_mesh &mesh , const std::vector<std::vector<Hull_point> > &parts) { 
+	if ( decompositions.size() >= DECOMPOSITION_CACHE_ENTRIES ) decompositions.clear(); 
+	CachedParts &cached = decompositions[key]; 
+	cached.vertices = mesh.number_of_vertices(); 
+	cached.faces = mesh.number_of_faces(); 
+	cached.parts = parts; 
+	if ( decompositionDir.empty() ) return; 
+	std::string path = decompositionPath( key ); 
+	char suffix[64]; 
+	snprintf( suffix , sizeof(suffix) , ".%d-%llx.tmp" , (int)getpid() , 
+	          (unsigned long long)std::hash<std::thread::id>()( std::this_thread::get_id() ) ); 
+	std::string temp = path + suffix; 
+	std::ofstream file( temp.c_str() , std::ios::binary ); 
+	uint32_t header[3] = { cached.vertices , cached.faces , (uint32_t)parts.size() }; 
+	file.write( DECOMPOSITION_MAGIC , sizeof(DECOMPOSITION_MAGIC) ); 
+	file.write( (const char*)&key , sizeof(key) ); 
+	file.write( (const char*)header , sizeof(header) ); 
+	for ( size_t i = 0; i < parts.size(); i++ ) { 
+		uint32_t n = parts[i].size(); 
+		file.write( (const char*)&n , sizeof(n) ); 
+		for ( size_t j = 0; j < parts[i].size(); j++ ) { 
+			double xyz[3] = { parts[i][j].x() , parts[i][j].y() , parts[i][j].z() }; 
+			file.write( (const char*)xyz , sizeof(xyz) ); 
+		}
+	}
+	file.close(); 
+	if ( !file || rename( temp.c_str() , path.c_str() ) != 0 ) { 
+		remove( temp.c_str() ); 
+		PRINT( "Failed to write decomposition cache " + path ); 
+	}
+}
+
 // -------------------------------------------------------------------------
-// Following the existing openscad code as guide. Two Brep shapes converted
-// to CGAL Polyhedrons. 
+// Face of a flat hull: its vertices in order around their centre, in the 
+// plane of its first facet. 
 // -------------------------------------------------------------------------
- 
-bool BrepCgal::minkowski( TopoDS_Shape aShape , TopoDS_Shape bShape , TopoDS_Shape &rShape ) {
+static bool flatHullFace( const Hull_polyhedron &result , TopoDS_Shape &rShape ) { 
+	Hull_polyhedron::Halfedge_const_handle h = result.facets_begin()->halfedge(); 
+	gp_Pnt p = toPnt( h->vertex()->point() ); 
+	gp_Vec n = gp_Vec( p , toPnt( h->next()->vertex()->point() ) ) ^ gp_Vec( p , toPnt( h->next()->next()->vertex()->point() ) ); 
+	if ( n.Magnitude() <= gp::Resolution() ) return false; 
+	gp_Ax3 frame( p , gp_Dir( n ) ); 
+	gp_XYZ centre( 0.0 , 0.0 , 0.0 ); 
+	std::vector<gp_Pnt> corners; 
+	for ( Hull_polyhedron::Vertex_const_iterator v = result.vertices_begin(); v != result.vertices_end(); ++v ) { 
+		corners.push_back( toPnt( v->point() ) ); 
+		centre += corners.back().XYZ(); 
+	}
+	centre /= corners.size(); 
+	std::vector<std::pair<double,size_t> > order; 
+	for ( size_t i = 0; i < corners.size(); i++ ) { 
+		gp_Vec d( centre , corners[i].XYZ() ); 
+		order.push_back( std::make_pair( atan2( d.Dot( gp_Vec( frame.YDirection() ) ) , d.Dot( gp_Vec( frame.XDirection() ) ) ) , i ) ); 
+	}
+	std::sort( order.begin() , order.end() ); 
+	BRepBuilderAPI_MakePolygon polygon; 
+	for ( size_t i = 0; i < order.size(); i++ ) polygon.Add( corners[ order[i].second ] ); 
+	polygon.Close(); 
+	if ( !polygon.IsDone() ) return false; 
+	BRepBuilderAPI_MakeFace face( gp_Pln( frame ) , polygon.Wire() , Standard_True ); 
+	if ( !face.IsDone() ) return false; 
+	rShape = face.Face(); 
+	return true; 
+}
 
-	PRINT("Performing Minkowski."); 
+// -------------------------------------------------------------------------
+// Convex hull of n shapes. Each shape's points are gathered and cut down 
+// to its own hull in parallel, then the survivors are hulled once and the 
+// result built as a planar faced Brep, or a face if it is flat. 
+// -------------------------------------------------------------------------
+bool BrepCgal::hull( TopoDS_Shape *shapes, int n, TopoDS_Shape &rShape ) {
+	if ( n <= 0 ) return false; 
+	std::vector<std::vector<Hull_point> > points( n ); 
+	ExtremePoints collector( shapes , n , points ); 
+	int threads = std::min( n , (int)std::max( 1u , std::thread::hardware_concurrency() ) ); 
+	std::vector<std::thread> workers; 
+	for ( int t = 1; t < threads; t++ ) workers.push_back( std::thread( std::ref( collector ) ) ); 
+	collector(); 
+	for ( size_t t = 0; t < workers.size(); t++ ) workers[t].join(); 
+	if ( collector.Failed() ) { 
+		PRINT("Hull: could not take the points of every shape"); 
+		return false; 
+	}
 
-	std::stringstream output;
+	std::vector<Hull_point> all; 
+	for ( int i = 0; i < n; i++ ) all.insert( all.end() , points[i].begin() , points[i].end() ); 
+	if ( all.size() < 3 ) { 
+		PRINT("Hull: not enough points"); 
+		return false; 
+	}
+
+	CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour( CGAL::THROW_EXCEPTION ); 
+	bool success = false; 
+	try { 
+		Hull_polyhedron result; 
+		CGAL::convex_hull_3( all.begin() , all.end() , result ); 
+		double volume = hullVolume( result ); 
+		CGAL::Bbox_3 box = BoxOf( all ); 
+		double size = std::max( box.xmax() - box.xmin() , std::max( box.ymax() - box.ymin() , box.zmax() - box.zmin() ) ); 
+		if ( result.size_of_facets() > 0 && volume <= 1e-12 * size * size * size ) success = flatHullFace( result , rShape ); 
+		else if ( result.size_of_facets() > 0 ) success = !createBrepFromPolyhedron( result , rShape ); 
+	}
+	catch (const CGAL::Failure_exception &e) { 
+		PRINT( std::string("CGAL error in hull: ") + e.what() ); 
+	}
+	catch(...) { 
+		PRINT("Hull failed"); 
+	}
+	CGAL::set_error_behaviour( old_behaviour ); 
+	return success; 
+}
 
-	Polyhedron aMesh;
-	BrepToCgal(aShape,aMesh); 
-	CGAL::Polygon_mesh_processing::stitch_borders(aMesh);
-	Nef_polyhedron A(aMesh);
-
-	Polyhedron bMesh;
-	BrepToCgal(bShape,bMesh);
- 	CGAL::Polygon_mesh_processing::stitch_borders(bMesh);
-	Nef_polyhedron B(bMesh);
-
-	typedef CGAL::Epick Hull_kernel;
-
- std::list<Polyhedron> P[2];
- std::list<CGAL::Polyhedron_3<Hull_kernel> > result_parts;	
-
-  if ( (A.is_convex()) || (is_weakly_convex(aMesh))) {
-	PRINT("Minkowski: child A is convex"); 
-	P[0].push_back(aMesh);
- }
- else { 
-	PRINT("Minkowski: A was not convex doing decomposition"); 
-	Nef_polyhedron decomposed_nef;
-	decomposed_nef = A; 
-	CGAL::convex_decomposition_3(decomposed_nef);
-	Nef_polyhedron::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
-	for(; ci != decomposed_nef.volumes_end(); ++ci) {
-		if(ci->mark()) {
-			Polyhedron poly;
-			decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
-			P[0].push_back(poly);
+// -------------------------------------------------------------------------
+// Union of all the hull parts in one boolean. The first part is the 
+// argument and the rest are tools, so the intersections are found together 
+// instead of through N-1 fuses of a growing result. Falls back to the chain 
+// if the single fuse does not complete, and fails if that does not either. 
+// -------------------------------------------------------------------------
+static bool fuseParts( const std::vector<TopoDS_Shape> &parts , TopoDS_Shape &rShape ) { 
+	if ( parts.empty() ) return false; 
+	if ( parts.size() == 1 ) { 
+		rShape = parts[0]; 
+		return true; 
+	}
+	try { 
+		TopTools_ListOfShape arguments; 
+		TopTools_ListOfShape tools; 
+		arguments.Append( parts[0] ); 
+		for ( size_t i = 1; i < parts.size(); i++ ) tools.Append( parts[i] ); 
+		BRepAlgoAPI_Fuse op; 
+		op.SetArguments( arguments ); 
+		op.SetTools( tools ); 
+		op.SetRunParallel( Standard_True ); 
+		op.Build(); 
+		if ( op.IsDone() && !op.Shape().IsNull() ) { 
+			rShape = op.Shape(); 
+			return true; 
 		}
 	}
-	output << "Minkowski: decomposed into " << P[0].size();	
-  PRINT( output.str() ); 
-  output.clear(); 
- } 
-
-
-  if ( (B.is_convex()) || (is_weakly_convex(bMesh))) {
-	PRINT("Minkowski: child B is convex");  
-	P[1].push_back(bMesh);
- }
- else { 
-	PRINT("Minkowski: child B was not convex doing decomposition");  
-	Nef_polyhedron decomposed_nef;
-	decomposed_nef = B; 
-	CGAL::convex_decomposition_3(decomposed_nef);
-	Nef_polyhedron::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
-	for(; ci != decomposed_nef.volumes_end(); ++ci) {
-		if(ci->mark()) {
-			Polyhedron poly;
-			decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
-			P[1].push_back(poly);
+	catch(...) { 
+	}
+	PRINT("Minkowski: single fuse failed, fusing parts in turn"); 
+	try { 
+		TopoDS_Shape result = parts[0]; 
+		for ( size_t i = 1; i < parts.size(); i++ ) { 
+			BRepAlgoAPI_Fuse op( result , parts[i] ); 
+			if ( !op.IsDone() || op.Shape().IsNull() ) { 
+				PRINT("Minkowski: fusing parts failed"); 
+				return false; 
+			}
+			result = op.Shape(); 
 		}
+		rShape = result; 
+		return true; 
 	}
-	output << "Minkowski: decomposed into " << P[1].size();	
-  PRINT( output.str() ); 
-  output.clear(); 
- } 
- 
+	catch(...) { 
+		PRINT("Minkowski: fusing parts failed"); 
+	}
+	return false; 
+}
+
+// -------------------------------------------------------------------------
+// A straight edged wire as a polygon in the frame's xy plane, corners in 
+// the order the wire runs. 
+// -------------------------------------------------------------------------
+static bool polygonOfWire( const TopoDS_Wire &wire , const TopoDS_Face &face , const gp_Ax3 &frame , Polygon_2 &polygon ) { 
+	gp_Vec x( frame.XDirection() ); 
+	gp_Vec y( frame.YDirection() ); 
+	for ( BRepTools_WireExplorer exp( wire , face ); exp.More(); exp.Next() ) { 
+		if ( BRepAdaptor_Curve( exp.Current() ).GetType() != GeomAbs_Line ) return false; 
+		gp_Vec p( gp::Origin() , BRep_Tool::Pnt( exp.CurrentVertex() ) ); 
+		Kernel::Point_2 corner( p.Dot( x ) , p.Dot( y ) ); 
+		if ( polygon.is_empty() || *(polygon.vertices_end() - 1) != corner ) polygon.push_back( corner ); 
+	}
+	if ( polygon.size() > 1 && polygon.vertex( 0 ) == *(polygon.vertices_end() - 1) ) polygon.erase( polygon.vertices_end() - 1 ); 
+	return polygon.size() >= 3 && polygon.is_simple(); 
+}
+
+// -------------------------------------------------------------------------
+// Every face of a flat shape as a polygon with holes in the frame, with the 
+// height of its plane along the frame normal. 
+// -------------------------------------------------------------------------
+static bool polygonsOfShape( const TopoDS_Shape &shape , const gp_Ax3 &frame , std::vector<Polygon_with_holes_2> &polygons , double &height ) { 
+	for ( TopExp_Explorer exp( shape , TopAbs_FACE ); exp.More(); exp.Next() ) { 
+		const TopoDS_Face &face = TopoDS::Face( exp.Current() ); 
+		TopoDS_Wire outerWire = BRepTools::OuterWire( face ); 
+		Polygon_2 outer; 
+		if ( outerWire.IsNull() || !polygonOfWire( outerWire , face , frame , outer ) ) return false; 
+		if ( outer.is_clockwise_oriented() ) outer.reverse_orientation(); 
+		std::vector<Polygon_2> holes; 
+		for ( TopExp_Explorer wexp( face , TopAbs_WIRE ); wexp.More(); wexp.Next() ) { 
+			if ( wexp.Current().IsSame( outerWire ) ) continue; 
+			Polygon_2 hole; 
+			if ( !polygonOfWire( TopoDS::Wire( wexp.Current() ) , face , frame , hole ) ) return false; 
+			if ( hole.is_counterclockwise_oriented() ) hole.reverse_orientation(); 
+			holes.push_back( hole ); 
+		}
+		polygons.push_back( Polygon_with_holes_2( outer , holes.begin() , holes.end() ) ); 
+		TopExp_Explorer vexp( face , TopAbs_VERTEX ); 
+		height = gp_Vec( gp::Origin() , BRep_Tool::Pnt( TopoDS::Vertex( vexp.Current() ) ) ).Dot( gp_Vec( frame.Direction() ) ); 
+	}
+	return !polygons.empty(); 
+}
+
+// -------------------------------------------------------------------------
+// A closed polygon of the frame's plane at a height, back in 3d 
+// -------------------------------------------------------------------------
+static TopoDS_Wire wireOfPolygon( const Polygon_2 &polygon , const gp_Ax3 &frame , double height ) { 
+	BRepBuilderAPI_MakePolygon wire; 
+	for ( Polygon_2::Vertex_const_iterator v = polygon.vertices_begin(); v != polygon.vertices_end(); ++v ) { 
+		gp_XYZ p = frame.XDirection().XYZ() * CGAL::to_double( v->x() ) + 
+		           frame.YDirection().XYZ() * CGAL::to_double( v->y() ) + 
+		           frame.Direction().XYZ() * height; 
+		wire.Add( gp_Pnt( p ) ); 
+	}
+	wire.Close(); 
+	return wire.Wire(); 
+}
 
- std::vector<Hull_kernel::Point_3> points[2];
- std::vector<Hull_kernel::Point_3> minkowski_points;
-
- for (size_t i = 0; i < P[0].size(); i++) {
- 	for (size_t j = 0; j < P[1].size(); j++) {
-		points[0].clear();
-		points[1].clear();
-		for (int k = 0; k < 2; k++) {
-			std::list<Polyhedron>::iterator it = P[k].begin();
-			std::advance(it, k==0?i:j);
-			Polyhedron const& poly = *it;
-			points[k].reserve(poly.size_of_vertices());
-			for (Polyhedron::Vertex_const_iterator pi = poly.vertices_begin(); pi != poly.vertices_end(); ++pi) {
-				Polyhedron::Point_3 const& p = pi->point();
-				points[k].push_back(Hull_kernel::Point_3(to_double(p[0]),to_double(p[1]),to_double(p[2])));
+// -------------------------------------------------------------------------
+// Minkowski of flat shapes in planes parallel to the frame's, summed in 2d. 
+// Polygons without holes go through a convex decomposition, ones with holes 
+// through the reduced convolution. The pair sums are joined exactly before 
+// they come back as faces. 
+// -------------------------------------------------------------------------
+bool BrepCgal::minkowski2d( TopoDS_Shape aShape , TopoDS_Shape bShape , const gp_Ax3 &frame , TopoDS_Shape &rShape ) { 
+	std::vector<Polygon_with_holes_2> a; 
+	std::vector<Polygon_with_holes_2> b; 
+	double aHeight = 0.0; 
+	double bHeight = 0.0; 
+	if ( !polygonsOfShape( aShape , frame , a , aHeight ) || !polygonsOfShape( bShape , frame , b , bHeight ) ) return false; 
+
+	PRINT("Performing 2d Minkowski."); 
+	CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour( CGAL::THROW_EXCEPTION ); 
+	bool success = false; 
+	try { 
+		std::vector<Polygon_with_holes_2> sums; 
+		for ( size_t i = 0; i < a.size(); i++ ) { 
+			for ( size_t j = 0; j < b.size(); j++ ) { 
+				if ( a[i].has_holes() || b[j].has_holes() ) sums.push_back( CGAL::minkowski_sum_2( a[i] , b[j] ) ); 
+				else sums.push_back( CGAL::minkowski_sum_2( a[i].outer_boundary() , b[j].outer_boundary() , 
+				                                            CGAL::Small_side_angle_bisector_decomposition_2<Kernel>() ) ); 
 			}
 		}
-		minkowski_points.clear();
-		minkowski_points.reserve(points[0].size() * points[1].size());
-		for (int i = 0; i < points[0].size(); i++) {
-			for (int j = 0; j < points[1].size(); j++) {
-				minkowski_points.push_back(points[0][i]+(points[1][j]-CGAL::ORIGIN));
+		std::vector<Polygon_with_holes_2> joined; 
+		if ( sums.size() == 1 ) joined = sums; 
+		else CGAL::join( sums.begin() , sums.end() , std::back_inserter( joined ) ); 
+
+		double height = aHeight + bHeight; 
+		gp_Pln plane( gp_Ax3( gp_Pnt( frame.Direction().XYZ() * height ) , frame.Direction() , frame.XDirection() ) ); 
+		std::vector<TopoDS_Face> faces; 
+		for ( size_t i = 0; i < joined.size(); i++ ) { 
+			if ( joined[i].is_unbounded() ) continue; 
+			BRepBuilderAPI_MakeFace face( plane , wireOfPolygon( joined[i].outer_boundary() , frame , height ) , Standard_True ); 
+			for ( Polygon_with_holes_2::Hole_const_iterator h = joined[i].holes_begin(); h != joined[i].holes_end(); ++h ) { 
+				face.Add( wireOfPolygon( *h , frame , height ) ); 
 			}
+			if ( face.IsDone() ) faces.push_back( face.Face() ); 
 		}
-		if (minkowski_points.size() <= 3) { continue;}
-		CGAL::Polyhedron_3<Hull_kernel> result;
-		CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), result);
-		std::vector<Hull_kernel::Point_3> strict_points;
-		strict_points.reserve(minkowski_points.size());
-		for (CGAL::Polyhedron_3<Hull_kernel>::Vertex_iterator i = result.vertices_begin(); i != result.vertices_end(); ++i) {
-			Hull_kernel::Point_3 const& p = i->point();
-			CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle h,e;
-			h = i->halfedge();
-			e = h;
-			bool collinear = false;
-			bool coplanar = true;
-			do {
-				Hull_kernel::Point_3 const& q = h->opposite()->vertex()->point();
-				if (coplanar && !CGAL::coplanar(p,q,
-					h->next_on_vertex()->opposite()->vertex()->point(),
-					h->next_on_vertex()->next_on_vertex()->opposite()->vertex()->point())) {
-					coplanar = false;
-				}
-				for (CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle j = h->next_on_vertex();
-					j != h && !collinear && ! coplanar;
-					j = j->next_on_vertex()) {
-						Hull_kernel::Point_3 const& r = j->opposite()->vertex()->point();
-						if (CGAL::collinear(p,q,r)) { collinear = true; }
-					}
-					h = h->next_on_vertex();
-				} 
-				while (h != e && !collinear);
-					if (!collinear && !coplanar) strict_points.push_back(p);
-				}
-				result.clear();
-				CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), result);
-				result_parts.push_back(result);
+		if ( faces.size() == 1 ) rShape = faces[0]; 
+		else if ( !faces.empty() ) { 
+			BRep_Builder builder; 
+			TopoDS_Compound compound; 
+			builder.MakeCompound( compound ); 
+			for ( size_t i = 0; i < faces.size(); i++ ) builder.Add( compound , faces[i] ); 
+			rShape = compound; 
 		}
- 	}
-
-	int count = 0; 
-	TopoDS_Shape nShape; 
-	for (std::list<CGAL::Polyhedron_3<Hull_kernel> >::iterator i = result_parts.begin(); i != result_parts.end(); ++i) {
-		createBrepFromPolyhedron( *i , nShape );
-		if ( count == 0 ) rShape = nShape; 
-		if ( count > 0 ) { 
-			rShape = BRepAlgoAPI_Fuse( rShape ,  nShape ).Shape();
-		} 
-		count++; 
-  }
+		success = !faces.empty(); 
+	}
+	catch (const CGAL::Failure_exception &e) { 
+		PRINT( std::string("CGAL error in 2d minkowski: ") + e.what() ); 
+	}
+	catch(...) { 
+		PRINT("2d Minkowski failed"); 
+	}
+	CGAL::set_error_behaviour( old_behaviour ); 
+	return success; 
+}
 
-  return 0;
-	
+// -------------------------------------------------------------------------
+// Following the existing openscad code as guide. Two Brep shapes converted
+// to CGAL Polyhedrons. Fails if either cannot be meshed completely. 
+// -------------------------------------------------------------------------
+ 
+bool BrepCgal::minkowski( TopoDS_Shape aShape , TopoDS_Shape bShape , TopoDS_Shape &rShape , bool aConvex , bool bConvex ) {
 
-}
+	PRINT("Performing Minkowski."); 
+
+	// Each operand as one or more convex point sets. The exact Nef is only 
+	// built for operands that have to be decomposed. 
+	TopoDS_Shape shapes[2] = { aShape , bShape }; 
+	bool convex[2] = { aConvex , bConvex }; 
+	std::vector<std::vector<Hull_point> > parts[2]; 
+	for ( int k = 0; k < 2; k++ ) { 
+		std::string name( 1 , char( 'A' + k ) ); 
+		Hull_mesh mesh; 
+		if ( !BrepToCgal( shapes[k] , mesh ) ) { 
+			PRINT( "Minkowski: child " + name + " could not be meshed" ); 
+			return false; 
+		}
+		if ( convex[k] || is_convex_mesh( mesh ) ) { 
+			PRINT( "Minkowski: child " + name + " is convex" ); 
+			parts[k].resize( 1 ); 
+			MeshPoints( mesh , parts[k][0] ); 
+			continue; 
+		}
+		uint64_t key = meshHash( mesh ); 
+		if ( approximateParts > 0 ) { 
+			key = fnv1a( key , &approximateParts , sizeof(approximateParts) ); 
+			key = fnv1a( key , &approximateConcavity , sizeof(approximateConcavity) ); 
+		}
+		key = fnv1a( key , &snapGrid , sizeof(snapGrid) ); 
+		if ( cachedDecomposition( key , mesh , parts[k] ) ) { 
+			PRINT( "Minkowski: child " + name + " decomposition from cache" ); 
+			continue; 
+		}
+		if ( approximateParts > 0 ) { 
+			PRINT( "Minkowski: child " + name + " was not convex doing approximate decomposition" ); 
+			ApproximateDecomposer( approximateParts , approximateConcavity ).Perform( mesh , parts[k] ); 
+			cacheDecomposition( key , mesh , parts[k] ); 
+			continue; 
+		}
+		PRINT( "Minkowski: child " + name + " was not convex doing decomposition" ); 
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); 
+		{ 
+			snapMesh( mesh ); 
+			Polyhedron poly; 
+			meshToPolyhedron( mesh , poly ); 
+			Nef_polyhedron nef( poly ); 
+			CGAL::convex_decomposition_3( nef ); 
+			Nef_polyhedron::Volume_const_iterator ci = ++nef.volumes_begin();
+			for(; ci != nef.volumes_end(); ++ci) {
+				if(ci->mark()) {
+					Polyhedron part;
+					nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), part);
+					parts[k].push_back( std::vector<Hull_point>() ); 
+					PartPoints( part , parts[k].back() ); 
+				}
+			}
+		}
+		double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count(); 
+		std::stringstream output;
+		output << "Minkowski: decomposed into " << parts[k].size() << " in " << seconds << "s";	
+		PRINT( output.str() ); 
+		mergeParts( parts[k] ); 
+		cacheDecomposition( key , mesh , parts[k] ); 
+	}
 
+	// Hull every pair of parts, one job per pair across the cores 
+	std::vector<ConvexPart> convexParts[2]; 
+	for ( int k = 0; k < 2; k++ ) { 
+		convexParts[k].resize( parts[k].size() ); 
+		for ( size_t i = 0; i < parts[k].size(); i++ ) BuildPart( parts[k][i] , convexParts[k][i] ); 
+	}
+	size_t jobs = parts[0].size() * parts[1].size(); 
+	std::vector<Hull_polyhedron> result_parts( jobs ); 
+	std::vector<char> done( jobs , 0 ); 
+	PairHuller huller( convexParts[0] , convexParts[1] , result_parts , done ); 
+	size_t threads = std::min<size_t>( jobs , std::max( 1u , std::thread::hardware_concurrency() ) ); 
+	std::vector<std::thread> workers; 
+	for ( size_t t = 1; t < threads; t++ ) workers.push_back( std::thread( std::ref( huller ) ) ); 
+	huller(); 
+	for ( size_t t = 0; t < workers.size(); t++ ) workers[t].join(); 
+	if ( huller.Failed() ) { 
+		PRINT("Minkowski: a pair of parts could not be hulled"); 
+		return false; 
+	}
 
+	std::vector<TopoDS_Shape> hulls; 
+	for ( size_t i = 0; i < jobs; i++ ) {
+		if ( !done[i] ) continue; 
+		TopoDS_Shape nShape; 
+		bool converted = false; 
+		try { 
+			converted = !createBrepFromPolyhedron( result_parts[i] , nShape ) && !nShape.IsNull(); 
+		}
+		catch(...) { 
+		}
+		if ( !converted ) { 
+			PRINT("Minkowski: a hull could not be converted to Brep"); 
+			return false; 
+		}
+		hulls.push_back( nShape ); 
+	}
+	return fuseParts( hulls , rShape ); 
+}
@@ -23,15 +23,20 @@
 
 class StlMesh_Mesh;
 class TopoDS_Shape;
+class gp_Ax3;
 
 class BrepCgal 
 {
 public:
 
 	Standard_EXPORT BrepCgal(); 
-  template <typename Polyhedron> bool BrepToCgal(TopoDS_Shape& aShape, Polyhedron& p);
-	Standard_EXPORT bool minkowski(TopoDS_Shape aShape, TopoDS_Shape bShape, TopoDS_Shape &rShape);
-	Standard_EXPORT	bool hull( TopoDS_Shape *shapes, TopoDS_Shape &rShape );
+  template <typename Mesh> bool BrepToCgal(TopoDS_Shape& aShape, Mesh& mesh);
+	Standard_EXPORT bool minkowski(TopoDS_Shape aShape, TopoDS_Shape bShape, TopoDS_Shape &rShape, bool aConvex = false, bool bConvex = false);
+	Standard_EXPORT bool minkowski2d(TopoDS_Shape aShape, TopoDS_Shape bShape, const gp_Ax3 &frame, TopoDS_Shape &rShape);
+	Standard_EXPORT	bool hull( TopoDS_Shape *shapes, int n, TopoDS_Shape &rShape );
+	Standard_EXPORT static void SetDecompositionCache(const char* dir);
+	Standard_EXPORT static void SetApproximate(int maxParts, double concavity);
+	Standard_EXPORT static void SetSnapGrid(double grid);
 					
 protected:
 
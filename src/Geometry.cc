@@ -27,6 +27,7 @@
 #include <gp_Pln.hxx>
 #include <gp_Ax2.hxx>
 #include <gp_Circ.hxx>
+#include <gp_Ax3.hxx>
 
 #include <TopoDS.hxx>
 #include <TopoDS_Shape.hxx>
@@ -72,6 +73,24 @@
 #include <BRepBuilderAPI_MakeSolid.hxx>
 #include <BRepBuilderAPI_Transform.hxx>
 #include <BRepOffsetAPI_Sewing.hxx>
+#include <BRepOffsetAPI_MakeOffsetShape.hxx>
+#include <BRepOffsetAPI_MakeOffset.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepGProp.hxx>
+#include <GProp_GProps.hxx>
+#include <ShapeFix_Face.hxx>
+#include <ShapeUpgrade_UnifySameDomain.hxx>
+#include <BRepCheck_Analyzer.hxx>
+
+#include <TopTools_MapOfShape.hxx>
+#include <TopTools_ListIteratorOfListOfShape.hxx>
+#include <TopoDS_Iterator.hxx>
+#include <TopoDS_Compound.hxx>
+#include <BRep_Builder.hxx>
+
+// Compression 
+#include <zlib.h>
 
 // Brep To CGAL conversion 
 #include <PrintUtils.h>
@@ -84,10 +103,14 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <iterator>
+#include <string.h>
 
 // Math
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <cmath>
 #include <assert.h>
 
@@ -95,7 +118,7 @@ using namespace std;
 
 ReadWrite reader; 
 
-Geometry::Geometry() {
+Geometry::Geometry() : pendingSize(0), pendingCount(0) {
 }
 
 // Prim 2d circle 
@@ -309,28 +332,229 @@ bool Geometry::extrude(float h1,TopoDS_Shape &aShape) {
 	return false; 
 }
 
-// Generate minkowski 
-bool Geometry::minkowski(TopoDS_Shape &aShape,TopoDS_Shape bShape) { 	
+// Placement of a primitive after a translation 
+ShapeInfo ShapeInfo::translated(float x , float y , float z) const { 
+	ShapeInfo info = *this; 
+	gp_Trsf trsf; 
+	trsf.SetTranslation( gp_Vec( x , y , z ) ); 
+	info.placement.PreMultiply( trsf ); 
+	return info; 
+}
+
+// Placement of a primitive after a rotation 
+ShapeInfo ShapeInfo::rotated(const gp_Ax1 &axis , float angle) const { 
+	ShapeInfo info = *this; 
+	gp_Trsf trsf; 
+	trsf.SetRotation( axis , angle ); 
+	info.placement.PreMultiply( trsf ); 
+	return info; 
+}
+
+// A uniform scale keeps the primitive and scales its size, any other 
+// scale leaves a general shape. Scaling never changes convexity. 
+ShapeInfo ShapeInfo::scaled(float x , float y , float z) const { 
+	if ( kind == SHAPE_GENERAL || x != y || y != z || x == 0.0 ) { 
+		ShapeInfo info; 
+		info.convex = convex; 
+		return info; 
+	}
+	ShapeInfo info = *this; 
+	gp_Trsf trsf; 
+	trsf.SetScale( gp::Origin() , x ); 
+	info.placement.PreMultiply( trsf ); 
+	info.radius = radius * fabs( x ); 
+	return info; 
+}
+
+// Mesh a shape with the tolerances the CGAL operations work to 
+static void meshForCgal(const TopoDS_Shape &aShape) { 
+	// Tolerances 
+	Standard_Real tolerance = 0.25;
+	Standard_Real angular_tolerance = 0.5;
+	Standard_Real minTriangleSize = Precision::Confusion();
+	// Set the tolerances
+	BRepMesh_FastDiscret::Parameters m_MeshParams;
+	m_MeshParams.ControlSurfaceDeflection = Standard_True; 
+	m_MeshParams.Deflection = tolerance;
+	m_MeshParams.MinSize = minTriangleSize;
+	m_MeshParams.InternalVerticesMode = Standard_False;
+	m_MeshParams.Relative=Standard_False;
+	m_MeshParams.Angle = angular_tolerance;
+	BRepMesh_IncrementalMesh ( aShape, m_MeshParams );
+}
+
+// Minkowski sum of a solid and a sphere is the solid offset outwards by the 
+// radius with arc joins, moved to where the sphere is. Exact and smooth, 
+// and far cheaper than the general route. False if it does not apply. 
+bool Geometry::offset(TopoDS_Shape &aShape , const ShapeInfo &sphere) { 
+	if ( sphere.radius <= 0.0 ) return false; 
+	TopoDS_Shape solid; 
+	int solids = 0; 
+	for ( TopExp_Explorer exp( aShape , TopAbs_SOLID ); exp.More(); exp.Next() ) { 
+		solid = exp.Current(); 
+		solids++; 
+	}
+	if ( solids != 1 ) return false; // disjoint offsets may overlap 
+	TopExp_Explorer loose( aShape , TopAbs_FACE , TopAbs_SOLID ); 
+	if ( loose.More() ) return false; 
+	try { 
+		BRepOffsetAPI_MakeOffsetShape op( solid , sphere.radius , Precision::Confusion() , 
+		                                  BRepOffset_Skin , Standard_False , Standard_False , GeomAbs_Arc ); 
+		if ( !op.IsDone() ) return false; 
+		TopoDS_Shape rShape = op.Shape(); 
+		if ( rShape.IsNull() || !BRepCheck_Analyzer( rShape ).IsValid() ) return false; 
+		gp_Trsf centre; 
+		centre.SetTranslation( gp_Vec( sphere.placement.TranslationPart() ) ); 
+		aShape = BRepBuilderAPI_Transform( rShape , centre , false ).Shape(); 
+		return true; 
+	}
+	catch(...) { 
+		PRINT("Offset failed, using general minkowski"); 
+	}
+	return false; 
+}
+
+// Plane that every face of a flat shape lies in. Fails for solids and for 
+// faces that are curved or not in one plane. 
+static bool planeOf(const TopoDS_Shape &aShape , gp_Pln &plane) { 
+	TopExp_Explorer solids( aShape , TopAbs_SOLID ); 
+	if ( solids.More() ) return false; 
+	bool first = true; 
+	for ( TopExp_Explorer exp( aShape , TopAbs_FACE ); exp.More(); exp.Next() ) { 
+		BRepAdaptor_Surface surface( TopoDS::Face( exp.Current() ) , Standard_False ); 
+		if ( surface.GetType() != GeomAbs_Plane ) return false; 
+		gp_Pln facePlane = surface.Plane(); 
+		if ( first ) { 
+			plane = facePlane; 
+			first = false; 
+		}
+		else if ( !plane.Axis().IsParallel( facePlane.Axis() , Precision::Angular() ) || 
+		          plane.Distance( facePlane.Location() ) > Precision::Confusion() ) return false; 
+	}
+	return !first; 
+}
+
+// Circle bounding a shape that is a single round face, like Geometry::circle 
+static bool discOf(const TopoDS_Shape &aShape , gp_Circ &disc) { 
+	int faces = 0; 
+	int edges = 0; 
+	for ( TopExp_Explorer exp( aShape , TopAbs_FACE ); exp.More(); exp.Next() ) faces++; 
+	TopoDS_Edge edge; 
+	for ( TopExp_Explorer exp( aShape , TopAbs_EDGE ); exp.More(); exp.Next() ) { 
+		edge = TopoDS::Edge( exp.Current() ); 
+		edges++; 
+	}
+	if ( faces != 1 || edges != 1 ) return false; 
+	BRepAdaptor_Curve curve( edge ); 
+	if ( curve.GetType() != GeomAbs_Circle ) return false; 
+	disc = curve.Circle(); 
+	return disc.Radius() > Precision::Confusion(); 
+}
+
+static Standard_Real areaOf(const TopoDS_Shape &aShape) { 
+	GProp_GProps props; 
+	BRepGProp::SurfaceProperties( aShape , props ); 
+	return props.Mass(); 
+}
+
+// Minkowski of flat faces with a disc in a parallel plane is a 2d offset of 
+// each face by the disc radius, moved to the disc centre. The largest wire 
+// of an offset is the outside of the new face, the rest are its holes. 
+bool Geometry::offset2d(TopoDS_Shape &aShape , const gp_Pln &plane , const gp_Circ &disc) { 
+	if ( !disc.Axis().IsParallel( plane.Axis() , Precision::Angular() ) ) return false; 
+	try { 
+		std::vector<TopoDS_Shape> faces; 
+		for ( TopExp_Explorer exp( aShape , TopAbs_FACE ); exp.More(); exp.Next() ) { 
+			const TopoDS_Face &face = TopoDS::Face( exp.Current() ); 
+			BRepOffsetAPI_MakeOffset op( face , GeomAbs_Arc ); 
+			op.Perform( disc.Radius() ); 
+			if ( !op.IsDone() ) return false; 
+			std::vector<TopoDS_Wire> wires; 
+			size_t outer = 0; 
+			Standard_Real largest = 0.0; 
+			for ( TopExp_Explorer wexp( op.Shape() , TopAbs_WIRE ); wexp.More(); wexp.Next() ) { 
+				wires.push_back( TopoDS::Wire( wexp.Current() ) ); 
+				Standard_Real area = areaOf( BRepBuilderAPI_MakeFace( plane , wires.back() , Standard_True ).Face() ); 
+				if ( area > largest ) { 
+					largest = area; 
+					outer = wires.size() - 1; 
+				}
+			}
+			if ( wires.empty() || largest <= areaOf( face ) ) return false; // not grown outwards 
+			BRepBuilderAPI_MakeFace grown( plane , wires[outer] , Standard_True ); 
+			for ( size_t i = 0; i < wires.size(); i++ ) if ( i != outer ) grown.Add( wires[i] ); 
+			if ( !grown.IsDone() ) return false; 
+			ShapeFix_Face fix( grown.Face() ); 
+			fix.Perform(); 
+			faces.push_back( fix.Face() ); 
+		}
+		if ( faces.empty() ) return false; 
+		TopoDS_Shape rShape = faces[0]; 
+		if ( faces.size() > 1 ) { 
+			for ( size_t i = 1; i < faces.size(); i++ ) rShape = BRepAlgoAPI_Fuse( rShape , faces[i] ).Shape(); 
+			ShapeUpgrade_UnifySameDomain unify( rShape , Standard_True , Standard_True ); 
+			unify.Build(); 
+			rShape = unify.Shape(); 
+		}
+		gp_Trsf centre; 
+		centre.SetTranslation( gp_Vec( gp::Origin() , disc.Location() ) ); 
+		aShape = BRepBuilderAPI_Transform( rShape , centre , false ).Shape(); 
+		return true; 
+	}
+	catch(...) { 
+		PRINT("2d offset failed, using polygon minkowski"); 
+	}
+	return false; 
+}
+
+// Minkowski of two flat shapes in parallel planes, kept in 2d. A disc on 
+// either side is an offset, polygons are summed by CGAL in the plane. The 
+// result is a face ready for extrude. 
+bool Geometry::minkowski2d(TopoDS_Shape &aShape , TopoDS_Shape &bShape) { 
+	gp_Pln aPlane; 
+	gp_Pln bPlane; 
+	if ( !planeOf( aShape , aPlane ) || !planeOf( bShape , bPlane ) ) return false; 
+	if ( !aPlane.Axis().IsParallel( bPlane.Axis() , Precision::Angular() ) ) return false; 
+	gp_Circ disc; 
+	if ( discOf( bShape , disc ) && offset2d( aShape , aPlane , disc ) ) return true; 
+	if ( discOf( aShape , disc ) && offset2d( bShape , bPlane , disc ) ) { 
+		aShape = bShape; 
+		return true; 
+	}
+	try { 
+		TopoDS_Shape rShape; 
+		BrepCgal brepcgal; 
+		gp_Ax3 frame( gp::Origin() , aPlane.Axis().Direction() , aPlane.XAxis().Direction() ); 
+		if ( !brepcgal.minkowski2d( aShape , bShape , frame , rShape ) ) return false; 
+		aShape = rShape; 
+		return true; 
+	}
+	catch(const std::exception&) { 
+		PRINT("CGAL Assertion in 2d Minkowski"); 
+	}
+	return false; 
+}
+
+// Generate minkowski. Flat operands stay in 2d, with a sphere for either 
+// operand this is an offset, everything else goes through CGAL. 
+bool Geometry::minkowski(TopoDS_Shape &aShape,TopoDS_Shape bShape,const ShapeInfo *aInfo,const ShapeInfo *bInfo) { 	
+	if ( minkowski2d( aShape , bShape ) ) return true; 
+	if ( bInfo != NULL && bInfo->kind == SHAPE_SPHERE && offset( aShape , *bInfo ) ) return true; 
+	if ( aInfo != NULL && aInfo->kind == SHAPE_SPHERE && offset( bShape , *aInfo ) ) { 
+		aShape = bShape; 
+		return true; 
+	}
 	try { 	
-		// Tolerances 
-		Standard_Real tolerance = 0.25;
-		Standard_Real angular_tolerance = 0.5;
-		Standard_Real minTriangleSize = Precision::Confusion();
-		// Set the tolerances
-		BRepMesh_FastDiscret::Parameters m_MeshParams;
-		m_MeshParams.ControlSurfaceDeflection = Standard_True; 
-		m_MeshParams.Deflection = tolerance;
-		m_MeshParams.MinSize = minTriangleSize;
-		m_MeshParams.InternalVerticesMode = Standard_False;
-		m_MeshParams.Relative=Standard_False;
-		m_MeshParams.Angle = angular_tolerance;
 		// Incremental meshes from shapes 
-		BRepMesh_IncrementalMesh ( aShape, m_MeshParams );
-		BRepMesh_IncrementalMesh ( bShape, m_MeshParams );
+		meshForCgal( aShape ); 
+		meshForCgal( bShape ); 
 		TopoDS_Shape rShape;
 	 	// In to the CGAL. Putting cgal geometry operations in thar for now  
 		BrepCgal brepcgal;
-		brepcgal.minkowski( aShape , bShape , rShape );
+		if ( !brepcgal.minkowski( aShape , bShape , rShape , aInfo != NULL && aInfo->convex , bInfo != NULL && bInfo->convex ) ) { 
+			PRINT("Minkowski failed"); 
+			return false; 
+		}
 		aShape = rShape; 
 		return true; 
 	}
@@ -341,10 +565,50 @@ bool Geometry::minkowski(TopoDS_Shape &aShape,TopoDS_Shape bShape) {
 }
 
 
+// Convex hull of a number of shapes 
+bool Geometry::hull(TopoDS_Shape *shapes , int n , TopoDS_Shape &rShape) { 
+	try { 
+		for ( int i = 0; i < n; i++ ) meshForCgal( shapes[i] ); 
+		BrepCgal brepcgal; 
+		return brepcgal.hull( shapes , n , rShape ); 
+	}
+	catch(const std::exception&) { 
+		PRINT("CGAL Assertion in Hull"); 
+	}
+	catch(...) { 
+		PRINT("Failed to mesh hull operand"); 
+	}
+	return false; 
+}
+
+// Record in the mesh state which faces of a boolean result the history says 
+// were modified or generated. The others are operand faces passed through 
+// untouched and keep the triangulation they already have. 
+void Geometry::history(BRepAlgoAPI_BooleanOperation &op, const TopoDS_Shape &aShape, const TopoDS_Shape &bShape, MeshState *state) { 
+	if ( state == NULL ) return; 
+	state->dirty.Clear(); 
+	if ( !op.IsDone() ) { *state = MeshState(); return; }
+	if ( state->deflection <= 0.0 ) return; // nothing meshed to keep 
+	TopTools_MapOfShape seen; 
+	const TopoDS_Shape operands[2] = { aShape , bShape }; 
+	for ( int i = 0; i < 2; i++ ) { 
+		for ( TopExp_Explorer exp( operands[i] , TopAbs_FACE ); exp.More(); exp.Next() ) { 
+			for ( TopTools_ListIteratorOfListOfShape it( op.Modified( exp.Current() ) ); it.More(); it.Next() ) { 
+				if ( it.Value().ShapeType() == TopAbs_FACE && seen.Add( it.Value() ) ) state->dirty.Append( it.Value() ); 
+			}
+			for ( TopTools_ListIteratorOfListOfShape it( op.Generated( exp.Current() ) ); it.More(); it.Next() ) { 
+				if ( it.Value().ShapeType() == TopAbs_FACE && seen.Add( it.Value() ) ) state->dirty.Append( it.Value() ); 
+			}
+		}
+	}
+}
+
 // Difference between two objects
-bool Geometry::difference(TopoDS_Shape &aShape, TopoDS_Shape &bShape) { 
+bool Geometry::difference(TopoDS_Shape &aShape, TopoDS_Shape &bShape, MeshState *state) { 
 	try { 
-		aShape = BRepAlgoAPI_Cut( aShape ,  bShape ).Shape();
+		BRepAlgoAPI_Cut op( aShape , bShape ); 
+		history( op , aShape , bShape , state ); 
+		aShape = op.Shape();
 		return true; 
 	}
 	catch(const std::exception&) { 
@@ -354,9 +618,11 @@ bool Geometry::difference(TopoDS_Shape &aShape, TopoDS_Shape &bShape) {
 }
 
 // Union between two objects
-bool Geometry::uni(TopoDS_Shape &aShape, TopoDS_Shape &bShape) { 
+bool Geometry::uni(TopoDS_Shape &aShape, TopoDS_Shape &bShape, MeshState *state) { 
 	try { 
-		aShape = BRepAlgoAPI_Fuse( aShape ,  bShape ).Shape();
+		BRepAlgoAPI_Fuse op( aShape , bShape ); 
+		history( op , aShape , bShape , state ); 
+		aShape = op.Shape();
 		return true; 
 	}
 	catch(const std::exception&) { 
@@ -366,9 +632,11 @@ bool Geometry::uni(TopoDS_Shape &aShape, TopoDS_Shape &bShape) {
 }
 
 // Intersection between two objects
-bool Geometry::intersection(TopoDS_Shape &aShape, TopoDS_Shape &bShape) { 
+bool Geometry::intersection(TopoDS_Shape &aShape, TopoDS_Shape &bShape, MeshState *state) { 
 	try { 
-		aShape = BRepAlgoAPI_Common( aShape ,  bShape ).Shape();
+		BRepAlgoAPI_Common op( aShape , bShape ); 
+		history( op , aShape , bShape , state ); 
+		aShape = op.Shape();
 		return true; 
 	}
 	catch(const std::exception&) { 
@@ -379,17 +647,233 @@ bool Geometry::intersection(TopoDS_Shape &aShape, TopoDS_Shape &bShape) {
 
 // add a new shape to the stack 
 bool Geometry::add(TopoDS_Shape shapeA) {
+		return add( shapeA , ShapeInfo() ); 
+}
+
+// add a new shape to the stack along with how it was made 
+bool Geometry::add(TopoDS_Shape shapeA , const ShapeInfo &info) {
 		shapeStack.push_back( shapeA );
+		meshStack.push_back( MeshState() ); 
+		infoStack.push_back( info ); 
 		return true; 
 }
-// alter an existing shape in the stack 
+// alter an existing shape in the stack, its old triangulation no longer applies 
 bool Geometry::set(int indexA , TopoDS_Shape shapeA) {
+		return set( indexA , shapeA , MeshState() ); 
+}
+
+// alter an existing shape in the stack keeping what is known of its mesh 
+bool Geometry::set(int indexA , TopoDS_Shape shapeA , const MeshState &state) {
+		return set( indexA , shapeA , state , ShapeInfo() ); 
+}
+
+// alter an existing shape in the stack keeping what is known of its mesh 
+// and of how it was made 
+bool Geometry::set(int indexA , TopoDS_Shape shapeA , const MeshState &state , const ShapeInfo &info) {
+		if ( !pending.empty() && !materialize() ) return false; 
+		if ( indexA < 0 || indexA >= (int)shapeStack.size() ) return false; 
 		shapeStack[indexA] = shapeA;
+		meshStack[indexA] = state; 
+		infoStack[indexA] = info; 
 		return true; 
 }
 
+// empty the stack 
+void Geometry::clear() { 
+	shapeStack.clear(); 
+	meshStack.clear(); 
+	infoStack.clear(); 
+	pending.clear(); 
+	pendingSize = pendingCount = 0; 
+}
+
+// Snapshot layout: magic, entry count, inflated size, the ShapeInfo of each 
+// entry, then the whole stack as one compound in the binary BREP format 
+// deflated with zlib. Sub-shapes shared between entries are written once by 
+// the binary shape set. 
+static const char SNAPSHOT_MAGIC[8] = { 'M','K','S','N','A','P','2','\0' }; 
+static const size_t SNAPSHOT_INFO_VALUES = 16;  // kind, convex, radius, form, 3x4 placement 
+
+static void packInfo(const ShapeInfo &info , double *values) { 
+	values[0] = info.kind; 
+	values[1] = info.convex ? 1.0 : 0.0; 
+	values[2] = info.radius; 
+	values[3] = info.placement.Form(); 
+	for ( int r = 1; r <= 3; r++ ) for ( int c = 1; c <= 4; c++ ) values[ 4 * r + c - 1 ] = info.placement.Value( r , c ); 
+}
+
+static ShapeInfo unpackInfo(const double *values) { 
+	ShapeInfo info; 
+	if ( values[0] < SHAPE_GENERAL || values[0] > SHAPE_CIRCLE ) return info; 
+	info.kind = (int)values[0]; 
+	info.convex = values[1] != 0.0; 
+	info.radius = values[2]; 
+	if ( values[3] != gp_Identity ) { 
+		try { 
+			info.placement.SetValues( values[4] , values[5] , values[6] , values[7] , 
+			                          values[8] , values[9] , values[10] , values[11] , 
+			                          values[12] , values[13] , values[14] , values[15] ); 
+		}
+		catch(...) { 
+			return ShapeInfo(); 
+		}
+	}
+	return info; 
+}
+
+// save the whole stack to a snapshot file 
+bool Geometry::save(const char *path) { 
+	if ( !pending.empty() && !materialize() ) return false; 
+	BRep_Builder builder; 
+	TopoDS_Compound stack; 
+	builder.MakeCompound( stack ); 
+	for ( size_t i = 0; i < shapeStack.size(); i++ ) { 
+		if ( shapeStack[i].IsNull() ) { 
+			TopoDS_Compound empty; 
+			builder.MakeCompound( empty ); 
+			builder.Add( stack , empty ); 
+		}
+		else builder.Add( stack , shapeStack[i] ); 
+	}
+	Buffer raw; 
+	if ( !reader.WriteBinBREP( stack , &raw ) ) return false; 
+	uLongf packedSize = compressBound( raw.size ); 
+	std::vector<char> packed( packedSize ); 
+	int status = compress2( (Bytef*)&packed[0] , &packedSize , (const Bytef*)raw.data , raw.size , Z_BEST_SPEED ); 
+	uint64_t header[2] = { shapeStack.size() , raw.size }; 
+	reader.FreeBuffer( &raw ); 
+	if ( status != Z_OK ) { 
+		PRINT("Failed to compress snapshot"); 
+		return false; 
+	}
+	std::vector<double> infos( SNAPSHOT_INFO_VALUES * infoStack.size() ); 
+	for ( size_t i = 0; i < infoStack.size(); i++ ) packInfo( infoStack[i] , &infos[ SNAPSHOT_INFO_VALUES * i ] ); 
+	std::ofstream file( path , std::ios::binary ); 
+	file.write( SNAPSHOT_MAGIC , sizeof(SNAPSHOT_MAGIC) ); 
+	file.write( (const char*)header , sizeof(header) ); 
+	if ( !infos.empty() ) file.write( (const char*)&infos[0] , infos.size() * sizeof(double) ); 
+	file.write( &packed[0] , packedSize ); 
+	file.close(); 
+	if ( !file ) { 
+		PRINT( std::string("Failed to write snapshot ") + path ); 
+		return false; 
+	}
+	return true; 
+}
+
+// replace the stack with a snapshot file. The shapes are only inflated and 
+// parsed the first time one of them is needed, until then the stack just 
+// has the right number of entries. Returns that number or -1. A payload 
+// that turns out not to inflate or parse empties the stack then, and the 
+// get() or set() that found it fails. 
+int Geometry::load(const char *path) { 
+	std::ifstream file( path , std::ios::binary ); 
+	char magic[sizeof(SNAPSHOT_MAGIC)]; 
+	uint64_t header[2]; 
+	if ( !file.read( magic , sizeof(magic) ) || memcmp( magic , SNAPSHOT_MAGIC , sizeof(magic) ) != 0 || 
+	     !file.read( (char*)header , sizeof(header) ) ) { 
+		PRINT( std::string("Not a snapshot ") + path ); 
+		return -1; 
+	}
+	std::vector<char> packed( ( std::istreambuf_iterator<char>( file ) ) , std::istreambuf_iterator<char>() ); 
+	std::vector<double> infos; 
+	if ( header[0] <= (uint64_t)INT_MAX ) { 
+		size_t infoBytes = header[0] * SNAPSHOT_INFO_VALUES * sizeof(double); 
+		if ( infoBytes < packed.size() ) { 
+			infos.resize( header[0] * SNAPSHOT_INFO_VALUES ); 
+			if ( infoBytes > 0 ) memcpy( &infos[0] , &packed[0] , infoBytes ); 
+			packed.erase( packed.begin() , packed.begin() + infoBytes ); 
+		}
+		else packed.clear(); 
+	}
+	if ( packed.empty() ) { 
+		PRINT( std::string("Truncated snapshot ") + path ); 
+		return -1; 
+	}
+	// every entry takes at least a byte and deflate packs at most about 1032 to 1 
+	// zlib checks the payload itself when materialize() inflates it 
+	if ( header[0] > header[1] || header[0] > (uint64_t)INT_MAX || header[1] > (uint64_t)packed.size() * 1032 ) { 
+		PRINT( std::string("Corrupt snapshot ") + path ); 
+		return -1; 
+	}
+	try { 
+		clear(); 
+		pending.swap( packed ); 
+		pendingCount = header[0]; 
+		pendingSize = header[1]; 
+		shapeStack.resize( pendingCount ); 
+		meshStack.resize( pendingCount ); 
+		infoStack.resize( pendingCount ); 
+		for ( size_t i = 0; i < infos.size() / SNAPSHOT_INFO_VALUES; i++ ) infoStack[i] = unpackInfo( &infos[ SNAPSHOT_INFO_VALUES * i ] ); 
+		return (int)pendingCount; 
+	}
+	catch(const std::exception&) { 
+		PRINT( std::string("Failed to load snapshot ") + path ); 
+		clear(); 
+	}
+	return -1; 
+}
+
+// parse a loaded snapshot in to the entries it holds. If it cannot be read 
+// the stack is emptied rather than left with entries that have no shape. 
+bool Geometry::materialize() { 
+	std::vector<char> packed; 
+	packed.swap( pending ); 
+	try { 
+		std::vector<char> raw( pendingSize ); 
+		uLongf rawSize = pendingSize; 
+		TopoDS_Shape stack; 
+		if ( !raw.empty() && uncompress( (Bytef*)&raw[0] , &rawSize , (const Bytef*)&packed[0] , packed.size() ) == Z_OK && 
+		     reader.ReadBinBREP( &raw[0] , rawSize , stack ) ) { 
+			size_t i = 0; 
+			for ( TopoDS_Iterator it( stack ); it.More() && i < pendingCount; it.Next() , i++ ) { 
+				shapeStack[i] = it.Value(); 
+			}
+			if ( i == pendingCount ) return true; 
+		}
+	}
+	catch(const std::exception&) { 
+	}
+	PRINT("Failed to read snapshot"); 
+	clear(); 
+	return false; 
+}
+
+// mesh state of a shape in the stack 
+MeshState& Geometry::meshState(int index) { 
+	return meshStack[index]; 
+}
+
+// how a shape in the stack was made 
+ShapeInfo& Geometry::shapeInfo(int index) { 
+	return infoStack[index]; 
+}
+
+// what a result made from two shapes in the stack is known to be. Minkowski 
+// sums and intersections of convex shapes are convex. 
+ShapeInfo Geometry::convexIf(int indexA , int indexB) { 
+	ShapeInfo info; 
+	info.convex = infoStack[indexA].convex && infoStack[indexB].convex; 
+	return info; 
+}
+
+// mesh state a boolean of two shapes starts from. Faces passed through keep 
+// the coarser of the two triangulations, or none if either was unmeshed. 
+MeshState Geometry::combined(int indexA , int indexB) { 
+	MeshState state; 
+	const MeshState &a = meshStack[indexA]; 
+	const MeshState &b = meshStack[indexB]; 
+	if ( a.deflection > 0.0 && b.deflection > 0.0 && a.dirty.IsEmpty() && b.dirty.IsEmpty() ) { 
+		state.deflection = std::max( a.deflection , b.deflection ); 
+		state.angle = std::max( a.angle , b.angle ); 
+	}
+	return state; 
+}
+
 // get a shape from the stack 
 bool Geometry::get( int index , TopoDS_Shape &rShape) { 
+	if ( !pending.empty() && !materialize() ) return false; 
+	if ( index < 0 || index >= (int)shapeStack.size() ) return false; 
 	rShape = shapeStack[index]; 
 	return true; 
 }
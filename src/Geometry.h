@@ -1,16 +1,56 @@
+#include <gp_Trsf.hxx>
+#include <MeshState.h>
+
+#include <vector>
+
 class StlMesh_Mesh;
 class TopoDS_Shape;
+class gp_Pln;
+class gp_Circ;
+class BRepAlgoAPI_BooleanOperation;
+
+// What is known of how a shape in the stack was made. Primitives keep their 
+// kind and size and the rigid placement applied since, so operations like 
+// minkowski can take an analytic route instead of a general one. 
+enum ShapeKind { SHAPE_GENERAL = 0 , SHAPE_SPHERE , SHAPE_CUBE , SHAPE_CYLINDER , SHAPE_CONE , SHAPE_CIRCLE }; 
+
+struct ShapeInfo { 
+	ShapeInfo() : kind(SHAPE_GENERAL), radius(0.0), convex(false) {} 
+	ShapeInfo(int k , Standard_Real r) : kind(k), radius(r), convex(k != SHAPE_GENERAL) {} 
+	int kind; 
+	Standard_Real radius;  // sphere, cylinder and circle radius 
+	bool convex;           // known to be convex, primitives and what is made from them 
+	gp_Trsf placement;     // moves the primitive from where it was made 
+
+	ShapeInfo translated(float x , float y , float z) const; 
+	ShapeInfo rotated(const gp_Ax1 &axis , float angle) const; 
+	ShapeInfo scaled(float x , float y , float z) const; 
+}; 
 
 class Geometry { 
 	public:
 		Standard_EXPORT Geometry(); 
 		
 		std::vector<TopoDS_Shape> shapeStack; 
+		std::vector<MeshState> meshStack; // mesh state of each shape in the stack 
+		std::vector<ShapeInfo> infoStack; // how each shape in the stack was made 
 
 		Standard_EXPORT bool add(TopoDS_Shape shapeA);
 		Standard_EXPORT bool get( int index , TopoDS_Shape &rShape);
 		Standard_EXPORT bool set(int indexA , TopoDS_Shape shapeA);
+		Standard_EXPORT bool set(int indexA , TopoDS_Shape shapeA , const MeshState &state);
+		Standard_EXPORT bool set(int indexA , TopoDS_Shape shapeA , const MeshState &state , const ShapeInfo &info);
+		Standard_EXPORT bool add(TopoDS_Shape shapeA , const ShapeInfo &info);
 		Standard_EXPORT int currentIndex(); 
+		Standard_EXPORT void clear(); 
+
+		Standard_EXPORT bool save(const char *path); 
+		Standard_EXPORT int load(const char *path); 
+
+		Standard_EXPORT MeshState& meshState(int index); 
+		Standard_EXPORT MeshState combined(int indexA , int indexB); 
+		Standard_EXPORT ShapeInfo& shapeInfo(int index); 
+		Standard_EXPORT ShapeInfo convexIf(int indexA , int indexB); 
 
 		Standard_EXPORT bool circle(float r1,TopoDS_Shape &aShape);
 		Standard_EXPORT bool polyhedron(int **faces,float *points,int f_length,TopoDS_Shape &aShape); 
@@ -27,12 +67,21 @@ class Geometry {
 		Standard_EXPORT bool rotateZ(float z , TopoDS_Shape &aShape);
 		
 		Standard_EXPORT bool extrude(float h1, TopoDS_Shape &aShape);
-		Standard_EXPORT bool minkowski(TopoDS_Shape &aShape,TopoDS_Shape bShape);
+		Standard_EXPORT bool minkowski(TopoDS_Shape &aShape,TopoDS_Shape bShape,const ShapeInfo *aInfo = NULL,const ShapeInfo *bInfo = NULL);
+		Standard_EXPORT bool hull(TopoDS_Shape *shapes,int n,TopoDS_Shape &rShape);
 
-		Standard_EXPORT bool difference( TopoDS_Shape &aShape, TopoDS_Shape &bShape);
-		Standard_EXPORT bool uni(TopoDS_Shape &aShape, TopoDS_Shape &bShape);
-		Standard_EXPORT bool intersection(TopoDS_Shape &aShape,TopoDS_Shape &bShape);
+		Standard_EXPORT bool difference( TopoDS_Shape &aShape, TopoDS_Shape &bShape, MeshState *state = NULL);
+		Standard_EXPORT bool uni(TopoDS_Shape &aShape, TopoDS_Shape &bShape, MeshState *state = NULL);
+		Standard_EXPORT bool intersection(TopoDS_Shape &aShape,TopoDS_Shape &bShape, MeshState *state = NULL);
 
 	protected:
 	private:
+		bool materialize(); 
+		std::vector<char> pending;  // compressed snapshot loaded but not parsed yet 
+		size_t pendingSize;         // its size once inflated 
+		size_t pendingCount;        // stack entries it holds 
+		bool offset(TopoDS_Shape &aShape , const ShapeInfo &sphere); 
+		bool offset2d(TopoDS_Shape &aShape , const gp_Pln &plane , const gp_Circ &disc); 
+		bool minkowski2d(TopoDS_Shape &aShape , TopoDS_Shape &bShape); 
+		void history(BRepAlgoAPI_BooleanOperation &op, const TopoDS_Shape &aShape, const TopoDS_Shape &bShape, MeshState *state);
 }; 
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (c) Damien Towning         (connolly.damien@gmail.com) 2017 *
+ *                                                                         *
+ *   This file is part of the Makertron CSG cad system.                    *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Indexed triangle mesh handed across the ffi. The arrays are owned by the 
+// library and must be handed back to ffi_free_mesh once the host is done. 
+typedef struct MeshBuffer { 
+	float*    positions;  // x,y,z per vertex 
+	uint32_t  nVertices; 
+	uint32_t* indices;    // three vertex indices per triangle, outward winding 
+	uint32_t  nTriangles; 
+	float*    normals;    // x,y,z unit surface normal per vertex, NULL unless asked for 
+} MeshBuffer; 
+
+// Receives one chunk of a streamed mesh. The chunk and its arrays are only 
+// valid for the duration of the call, copy out anything that is kept. The 
+// rest of the shape is still being meshed while it runs, so it must not 
+// call back in to the library. 
+typedef void (*meshChunkFP_t)(const MeshBuffer* chunk, void* user); 
+
+// Receives one level of detail of a mesh, level is its position in the array 
+// of deflections asked for. Same lifetime and no re-entry rules as a chunk. 
+typedef void (*meshLodFP_t)(int level, const MeshBuffer* mesh, void* user); 
+
+// Block of bytes handed across the ffi, owned by the library until it is 
+// given back to ffi_free_buffer. 
+typedef struct Buffer { 
+	char*  data; 
+	size_t size; 
+} Buffer; 
+
+// File formats a mesh can be written in 
+enum MeshFormat { 
+	MESH_FORMAT_STL = 0, // binary STL, triangle soup with facet normals 
+	MESH_FORMAT_OBJ = 1, // Wavefront OBJ, welded 
+	MESH_FORMAT_PLY = 2  // binary little endian PLY, welded 
+}; 
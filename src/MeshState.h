@@ -0,0 +1,36 @@
+/***************************************************************************
+ *   Copyright (c) Damien Towning         (connolly.damien@gmail.com) 2017 *
+ *                                                                         *
+ *   This file is part of the Makertron CSG cad system.                    *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#pragma once
+
+#include <Standard_Real.hxx>
+#include <TopTools_ListOfShape.hxx>
+
+// What a shape's triangulations were last meshed at. A deflection of zero 
+// means not meshed yet. Dirty faces were made by a boolean since and still 
+// need meshing, the remaining faces kept their triangulations through it. 
+struct MeshState { 
+	MeshState() : deflection(0.0), angle(0.0) {}
+	Standard_Real deflection; 
+	Standard_Real angle; 
+	TopTools_ListOfShape dirty; 
+}; 
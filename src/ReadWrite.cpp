@@ -46,8 +46,21 @@
 #include <BRepBuilderAPI_GTransform.hxx>
 #include <BRepBuilderAPI_MakeSolid.hxx>
 #include <BRepBuilderAPI_Transform.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
 #include <BRepOffsetAPI_Sewing.hxx>
 
+#include <OSD_Parallel.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <BinTools.hxx>
+#include <STEPControl_Reader.hxx>
+#include <IGESControl_Reader.hxx>
+#include <IFSelect_ReturnStatus.hxx>
+#include <TopExp.hxx>
+#include <TopTools_ShapeMapHasher.hxx>
+#include <NCollection_DataMap.hxx>
+#include <Poly_PolygonOnTriangulation.hxx>
+#include <TopTools_ListIteratorOfListOfShape.hxx>
+
 // Brep To CGAL conversion 
 #include <PrintUtils.h>
 #include <ReadWrite.h>
@@ -57,15 +70,38 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <deque>
+#include <streambuf>
+
+// Threads 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Math
 #include <math.h>
 #include <float.h>
 #include <cmath>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
 
 using namespace std;
 
+// Streamed meshes go out in chunks of at most this many triangles, with at 
+// most MESH_CHUNK_QUEUE chunks waiting on the host at any time. Faces are 
+// meshed MESH_FACE_GROUP at a time ahead of the chunks being handed over. 
+static const size_t MESH_CHUNK_TRIANGLES = 16384; 
+static const size_t MESH_CHUNK_QUEUE     = 4; 
+static const size_t MESH_FACE_GROUP      = 64; 
+
+// Mesh files are handed to disk a megabyte at a time 
+static const size_t FILE_FLUSH_BYTES     = 1 << 20; 
+
 // Auxiliary tools
 namespace
 {
@@ -76,9 +112,8 @@ namespace
   public:
     TriangleAccessor (const TopoDS_Face& aFace)
     {
-      TopLoc_Location aLoc;
-      myPoly = BRep_Tool::Triangulation (aFace, aLoc);
-      myTrsf = aLoc.Transformation();
+      myPoly = BRep_Tool::Triangulation (aFace, myLoc);
+      myTrsf = myLoc.Transformation();
       myNbTriangles = (myPoly.IsNull() ? 0 : myPoly->Triangles().Length());
       myInvert = (aFace.Orientation() == TopAbs_REVERSED);
       if (myTrsf.IsNegative())
@@ -87,6 +122,43 @@ namespace
 
     int NbTriangles () const { return myNbTriangles; } 
 
+    int NbNodes () const { return (myPoly.IsNull() ? 0 : myPoly->NbNodes()); } 
+
+    bool HasUVNodes () const { return (!myPoly.IsNull() && myPoly->HasUVNodes()); }
+
+    // surface parameters of i-th node
+    const gp_Pnt2d& GetUV (int iNode) const { return myPoly->UVNodes()(iNode); }
+
+    // true if the surface normal points in to the material
+    bool IsInverted () const { return myInvert; }
+
+    // polygon of an edge of this face on the face triangulation
+    Handle(Poly_PolygonOnTriangulation) EdgePolygon (const TopoDS_Edge& theEdge) const
+    {
+      if (myPoly.IsNull())
+        return Handle(Poly_PolygonOnTriangulation)();
+      return BRep_Tool::PolygonOnTriangulation (theEdge, myPoly, myLoc);
+    }
+
+    // get i-th node with the face location applied
+    gp_Pnt GetNode (int iNode) const
+    {
+      gp_Pnt aPnt = myPoly->Nodes()(iNode);
+      if (myTrsf.Form() != gp_Identity)
+        aPnt.Transform (myTrsf);
+      return aPnt;
+    }
+
+    // get node indices of i-th triangle in outward winding
+    void GetTriangleNodes (int iTri, int &theNode1, int &theNode2, int &theNode3) const
+    {
+      int iNode1, iNode2, iNode3;
+      myPoly->Triangles()(iTri).Get (iNode1, iNode2, iNode3); 
+      theNode1 = iNode1;
+      theNode2 = (myInvert ? iNode3 : iNode2);
+      theNode3 = (myInvert ? iNode2 : iNode3);
+    }
+
     // get i-th triangle and outward normal
     void GetTriangle (int iTri, gp_Vec &theNormal, gp_Pnt &thePnt1, gp_Pnt &thePnt2, gp_Pnt &thePnt3)
     {
@@ -113,14 +185,632 @@ namespace
 
   private:
     Handle(Poly_Triangulation) myPoly;
+    TopLoc_Location myLoc;
     gp_Trsf myTrsf;
     int myNbTriangles;
     bool myInvert;
   };
 
+  // Faces of a shape in explorer order 
+  void CollectFaces (const TopoDS_Shape& theShape, std::vector<TopoDS_Face>& theFaces)
+  {
+    for (TopExp_Explorer exp (theShape, TopAbs_FACE); exp.More(); exp.Next())
+      theFaces.push_back (TopoDS::Face (exp.Current()));
+  }
+
+  // Triangles currently on the faces of a shape
+  int CountTriangles (const TopoDS_Shape& theShape)
+  {
+    int aCount = 0;
+    for (TopExp_Explorer exp (theShape, TopAbs_FACE); exp.More(); exp.Next())
+      aCount += TriangleAccessor (TopoDS::Face (exp.Current())).NbTriangles();
+    return aCount;
+  }
+
+  // Length of the bounding box diagonal of a shape, zero if it has none
+  Standard_Real Diagonal (const TopoDS_Shape& theShape)
+  {
+    Bnd_Box aBox;
+    BRepBndLib::Add (theShape, aBox);
+    return aBox.IsVoid() ? 0.0 : Sqrt (aBox.SquareExtent());
+  }
+
+  // Writes the triangles of a contiguous run of faces in to its own
+  // buffer so that runs can be dumped on separate threads and then
+  // joined back together in face order.
+  class FaceRunDumper
+  {
+  public:
+    FaceRunDumper (const std::vector<TopoDS_Face>& theFaces,
+                   std::vector<std::string>&       theBuffers)
+    : myFaces (theFaces), myBuffers (theBuffers) {}
+
+    void operator() (const Standard_Integer theRun) const
+    {
+      const size_t aNbRuns = myBuffers.size();
+      const size_t aFirst  = (myFaces.size() * theRun) / aNbRuns;
+      const size_t aLast   = (myFaces.size() * (theRun + 1)) / aNbRuns;
+      std::stringstream output;
+      for (size_t iFace = aFirst; iFace < aLast; iFace++)
+      {
+        TriangleAccessor aTool (myFaces[iFace]);
+        for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
+        {
+          gp_Vec aNorm;
+          gp_Pnt aPnt1, aPnt2, aPnt3;
+          aTool.GetTriangle (iTri, aNorm, aPnt1, aPnt2, aPnt3);
+          output << aPnt1.X() << "," << aPnt1.Y() << "," << aPnt1.Z() << ",";
+          output << aPnt2.X() << "," << aPnt2.Y() << "," << aPnt2.Z() << ",";
+          output << aPnt3.X() << "," << aPnt3.Y() << "," << aPnt3.Z() << ",";
+        }
+      }
+      myBuffers[theRun] = output.str();
+    }
+
+  private:
+    const std::vector<TopoDS_Face>& myFaces;
+    std::vector<std::string>&       myBuffers;
+  };
+
+  // Unit normal at every node of a face, taken from the surface at the node's
+  // UV so curved faces shade smoothly. Nodes where the surface derivatives
+  // vanish (poles, apexes) or faces without UV fall back to the average of
+  // the normals of the triangles around the node.
+  void NodeNormals (const TopoDS_Face& theFace, const TriangleAccessor& theTool, float* theNormals)
+  {
+    const int aNbNodes = theTool.NbNodes();
+    std::vector<gp_Vec> aNorms (aNbNodes + 1, gp_Vec (0.0, 0.0, 0.0));
+    std::vector<bool> aDone (aNbNodes + 1, false);
+    bool isAllDone = false;
+    if (theTool.HasUVNodes())
+    {
+      isAllDone = true;
+      BRepAdaptor_Surface aSurf (theFace);
+      for (int iNode = 1; iNode <= aNbNodes; iNode++)
+      {
+        gp_Pnt aPnt;
+        gp_Vec aDU, aDV;
+        const gp_Pnt2d& aUV = theTool.GetUV (iNode);
+        aSurf.D1 (aUV.X(), aUV.Y(), aPnt, aDU, aDV);
+        gp_Vec aNorm = aDU ^ aDV;
+        if (aNorm.Magnitude() > gp::Resolution())
+        {
+          aNorms[iNode] = theTool.IsInverted() ? -aNorm.Normalized() : aNorm.Normalized();
+          aDone[iNode] = true;
+        }
+        else
+          isAllDone = false;
+      }
+    }
+    if (!isAllDone)
+    {
+      std::vector<gp_Vec> aSums (aNbNodes + 1, gp_Vec (0.0, 0.0, 0.0));
+      for (int iTri = 1; iTri <= theTool.NbTriangles(); iTri++)
+      {
+        int aNodes[3];
+        theTool.GetTriangleNodes (iTri, aNodes[0], aNodes[1], aNodes[2]);
+        const gp_Pnt aPnt1 = theTool.GetNode (aNodes[0]);
+        const gp_Vec aNorm = gp_Vec (aPnt1, theTool.GetNode (aNodes[1])) ^ gp_Vec (aPnt1, theTool.GetNode (aNodes[2]));
+        for (int k = 0; k < 3; k++)
+          aSums[aNodes[k]] += aNorm;
+      }
+      for (int iNode = 1; iNode <= aNbNodes; iNode++)
+      {
+        if (!aDone[iNode] && aSums[iNode].Magnitude() > gp::Resolution())
+          aNorms[iNode] = aSums[iNode].Normalized();
+      }
+    }
+    for (int iNode = 1; iNode <= aNbNodes; iNode++)
+    {
+      *theNormals++ = (float )aNorms[iNode].X();
+      *theNormals++ = (float )aNorms[iNode].Y();
+      *theNormals++ = (float )aNorms[iNode].Z();
+    }
+  }
+
+  // Copies the nodes and triangles of one face in to a mesh buffer at
+  // offsets reserved for it, so faces can be written on separate threads.
+  // Nodes are shared by the triangles of their face.
+  class FaceMeshWriter
+  {
+  public:
+    FaceMeshWriter (const std::vector<TopoDS_Face>& theFaces,
+                    const std::vector<uint32_t>&    theNodeOffsets,
+                    const std::vector<uint32_t>&    theTriOffsets,
+                    MeshBuffer*                     theMesh)
+    : myFaces (theFaces), myNodeOffsets (theNodeOffsets),
+      myTriOffsets (theTriOffsets), myMesh (theMesh) {}
+
+    void operator() (const Standard_Integer theFace) const
+    {
+      TriangleAccessor aTool (myFaces[theFace]);
+      const uint32_t aBase = myNodeOffsets[theFace];
+      float* aPos = myMesh->positions + 3 * aBase;
+      for (int iNode = 1; iNode <= aTool.NbNodes(); iNode++)
+      {
+        gp_Pnt aPnt = aTool.GetNode (iNode);
+        *aPos++ = (float )aPnt.X();
+        *aPos++ = (float )aPnt.Y();
+        *aPos++ = (float )aPnt.Z();
+      }
+      uint32_t* anIdx = myMesh->indices + 3 * myTriOffsets[theFace];
+      for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
+      {
+        int iNode1, iNode2, iNode3;
+        aTool.GetTriangleNodes (iTri, iNode1, iNode2, iNode3);
+        *anIdx++ = aBase + iNode1 - 1;
+        *anIdx++ = aBase + iNode2 - 1;
+        *anIdx++ = aBase + iNode3 - 1;
+      }
+      if (myMesh->normals != NULL)
+        NodeNormals (myFaces[theFace], aTool, myMesh->normals + 3 * aBase);
+    }
+
+  private:
+    const std::vector<TopoDS_Face>& myFaces;
+    const std::vector<uint32_t>&    myNodeOffsets;
+    const std::vector<uint32_t>&    myTriOffsets;
+    MeshBuffer*                     myMesh;
+  };
+
+  // Chunk of a streamed mesh, indices are local to the chunk
+  struct MeshChunk
+  {
+    std::vector<float>    Positions;
+    std::vector<uint32_t> Indices;
+  };
+
+  // Bounded hand over of chunks from the extraction thread to the caller.
+  // Push blocks while the queue is full so memory stays bounded however
+  // large the shape is.
+  class ChunkQueue
+  {
+  public:
+    ChunkQueue (size_t theCapacity) : myCapacity (theCapacity), myClosed (false) {}
+
+    void Push (MeshChunk& theChunk)
+    {
+      std::unique_lock<std::mutex> aLock (myMutex);
+      while (myChunks.size() >= myCapacity)
+        myNotFull.wait (aLock);
+      myChunks.push_back (MeshChunk());
+      myChunks.back().Positions.swap (theChunk.Positions);
+      myChunks.back().Indices.swap (theChunk.Indices);
+      myNotEmpty.notify_one();
+    }
+
+    // false once the queue is closed and drained
+    bool Pop (MeshChunk& theChunk)
+    {
+      std::unique_lock<std::mutex> aLock (myMutex);
+      while (myChunks.empty() && !myClosed)
+        myNotEmpty.wait (aLock);
+      if (myChunks.empty())
+        return false;
+      theChunk.Positions.swap (myChunks.front().Positions);
+      theChunk.Indices.swap (myChunks.front().Indices);
+      myChunks.pop_front();
+      myNotFull.notify_one();
+      return true;
+    }
+
+    void Close ()
+    {
+      std::unique_lock<std::mutex> aLock (myMutex);
+      myClosed = true;
+      myNotEmpty.notify_all();
+    }
+
+  private:
+    size_t                  myCapacity;
+    bool                    myClosed;
+    std::deque<MeshChunk>   myChunks;
+    std::mutex              myMutex;
+    std::condition_variable myNotFull;
+    std::condition_variable myNotEmpty;
+  };
+
+  // Cuts face triangles in to fixed size chunks, faces larger than a chunk
+  // are split across chunks with their shared nodes repeated in each.
+  class ChunkBuilder
+  {
+  public:
+    ChunkBuilder (ChunkQueue& theQueue, size_t theMaxTriangles)
+    : myQueue (theQueue), myMaxTriangles (theMaxTriangles), myNbTriangles (0) {}
+
+    void AddFace (const TopoDS_Face& theFace)
+    {
+      TriangleAccessor aTool (theFace);
+      const uint32_t anUnset = UINT32_MAX;
+      std::vector<uint32_t> anIds (aTool.NbNodes() + 1, anUnset);
+      for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
+      {
+        if (myChunk.Indices.size() / 3 >= myMaxTriangles)
+        {
+          Flush();
+          anIds.assign (anIds.size(), anUnset);
+        }
+        int aNodes[3];
+        aTool.GetTriangleNodes (iTri, aNodes[0], aNodes[1], aNodes[2]);
+        for (int k = 0; k < 3; k++)
+        {
+          if (anIds[aNodes[k]] == anUnset)
+          {
+            gp_Pnt aPnt = aTool.GetNode (aNodes[k]);
+            anIds[aNodes[k]] = (uint32_t )(myChunk.Positions.size() / 3);
+            myChunk.Positions.push_back ((float )aPnt.X());
+            myChunk.Positions.push_back ((float )aPnt.Y());
+            myChunk.Positions.push_back ((float )aPnt.Z());
+          }
+          myChunk.Indices.push_back (anIds[aNodes[k]]);
+        }
+        myNbTriangles++;
+      }
+    }
+
+    void Flush ()
+    {
+      if (myChunk.Indices.empty())
+        return;
+      myQueue.Push (myChunk);
+      myChunk.Positions.clear();
+      myChunk.Indices.clear();
+    }
+
+    size_t NbTriangles () const { return myNbTriangles; }
+
+  private:
+    ChunkQueue& myQueue;
+    size_t      myMaxTriangles;
+    size_t      myNbTriangles;
+    MeshChunk   myChunk;
+  };
+
+  // Growable output for the mesh file writers. Without a file everything is
+  // collected in one malloc'd block that can be handed over as is, with a
+  // file the block is written out whenever a megabyte has built up.
+  class ByteWriter
+  {
+  public:
+    ByteWriter (FILE* theFile = NULL)
+    : myFile (theFile), myData (NULL), mySize (0), myCapacity (0), myFailed (false) {}
+
+    ~ByteWriter () { free (myData); }
+
+    void Write (const void* theData, size_t theSize)
+    {
+      if (myFile != NULL && mySize + theSize > FILE_FLUSH_BYTES)
+      {
+        Flush();
+        // a block bigger than the buffer goes straight out
+        if (theSize > FILE_FLUSH_BYTES)
+        {
+          if (fwrite (theData, 1, theSize, myFile) != theSize)
+            myFailed = true;
+          return;
+        }
+      }
+      if (mySize + theSize > myCapacity)
+      {
+        size_t aCapacity = myCapacity == 0 ? 4096 : myCapacity;
+        while (aCapacity < mySize + theSize)
+          aCapacity *= 2;
+        char* aData = (char* )realloc (myData, aCapacity);
+        if (aData == NULL)
+        {
+          myFailed = true;
+          return;
+        }
+        myData = aData;
+        myCapacity = aCapacity;
+      }
+      memcpy (myData + mySize, theData, theSize);
+      mySize += theSize;
+    }
+
+    template <typename T> void Put (const T theValue) { Write (&theValue, sizeof (T)); }
+
+    void Print (const char* theFormat, ...)
+    {
+      char aLine[256];
+      va_list anArgs;
+      va_start (anArgs, theFormat);
+      int aLength = vsnprintf (aLine, sizeof (aLine), theFormat, anArgs);
+      va_end (anArgs);
+      if (aLength > 0)
+        Write (aLine, std::min ((size_t )aLength, sizeof (aLine) - 1));
+    }
+
+    void Flush ()
+    {
+      if (myFile != NULL && mySize > 0)
+      {
+        if (fwrite (myData, 1, mySize, myFile) != mySize)
+          myFailed = true;
+        mySize = 0;
+      }
+    }
+
+    // hands the collected block over, the writer is empty afterwards
+    char* Release (size_t& theSize)
+    {
+      char* aData = myData;
+      theSize = mySize;
+      myData = NULL;
+      mySize = myCapacity = 0;
+      return aData;
+    }
+
+    bool Failed () const { return myFailed; }
+
+  private:
+    FILE*  myFile;
+    char*  myData;
+    size_t mySize;
+    size_t myCapacity;
+    bool   myFailed;
+  };
+
+  // Input stream buffer reading straight out of the caller's memory
+  class MemoryStreamBuf : public std::streambuf
+  {
+  public:
+    MemoryStreamBuf (const void* theData, size_t theSize)
+    {
+      char* aBegin = (char* )theData;
+      setg (aBegin, aBegin, aBegin + theSize);
+    }
+
+  protected:
+    virtual pos_type seekoff (off_type theOff, std::ios_base::seekdir theDir,
+                              std::ios_base::openmode /*theMode*/ = std::ios_base::in)
+    {
+      char* aPos = theDir == std::ios_base::beg ? eback()
+                 : theDir == std::ios_base::cur ? gptr() : egptr();
+      aPos += theOff;
+      if (aPos < eback() || aPos > egptr())
+        return pos_type (off_type (-1));
+      setg (eback(), aPos, egptr());
+      return pos_type (aPos - eback());
+    }
+
+    virtual pos_type seekpos (pos_type thePos, std::ios_base::openmode theMode = std::ios_base::in)
+    {
+      return seekoff (off_type (thePos), std::ios_base::beg, theMode);
+    }
+  };
+
+  // Output stream buffer collecting in to a ByteWriter so the result can be
+  // handed over without another copy
+  class WriterStreamBuf : public std::streambuf
+  {
+  public:
+    WriterStreamBuf (ByteWriter& theWriter) : myWriter (theWriter) {}
+
+  protected:
+    virtual int_type overflow (int_type theChar)
+    {
+      if (theChar != traits_type::eof())
+      {
+        const char aChar = (char )theChar;
+        myWriter.Write (&aChar, 1);
+      }
+      return myWriter.Failed() ? traits_type::eof() : traits_type::not_eof (theChar);
+    }
+
+    virtual std::streamsize xsputn (const char* theData, std::streamsize theSize)
+    {
+      myWriter.Write (theData, (size_t )theSize);
+      return myWriter.Failed() ? 0 : theSize;
+    }
+
+  private:
+    ByteWriter& myWriter;
+  };
+
+  // The binary formats are little endian and the writers put host order
+  // bytes straight out
+#ifdef __BYTE_ORDER__
+  static_assert (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "mesh writers need a little endian host");
+#endif
+
+  // Binary STL: 80 byte header, triangle count, then per triangle a facet
+  // normal, three corners and an unused attribute word, little endian.
+  void EncodeSTL (const MeshBuffer& theMesh, ByteWriter& theOut)
+  {
+    char aHeader[80];
+    memset (aHeader, 0, sizeof (aHeader));
+    strncpy (aHeader, "binary STL, created with Makertron Technology", sizeof (aHeader) - 1);
+    theOut.Write (aHeader, sizeof (aHeader));
+    theOut.Put<uint32_t> (theMesh.nTriangles);
+    for (uint32_t iTri = 0; iTri < theMesh.nTriangles; iTri++)
+    {
+      const float* aCorners[3];
+      for (int k = 0; k < 3; k++)
+        aCorners[k] = theMesh.positions + 3 * theMesh.indices[3 * iTri + k];
+      gp_Vec aNorm = gp_Vec (gp_Pnt (aCorners[0][0], aCorners[0][1], aCorners[0][2]),
+                             gp_Pnt (aCorners[1][0], aCorners[1][1], aCorners[1][2]))
+                   ^ gp_Vec (gp_Pnt (aCorners[0][0], aCorners[0][1], aCorners[0][2]),
+                             gp_Pnt (aCorners[2][0], aCorners[2][1], aCorners[2][2]));
+      if (aNorm.Magnitude() > gp::Resolution())
+        aNorm.Normalize();
+      theOut.Put<float> ((float )aNorm.X());
+      theOut.Put<float> ((float )aNorm.Y());
+      theOut.Put<float> ((float )aNorm.Z());
+      for (int k = 0; k < 3; k++)
+        theOut.Write (aCorners[k], 3 * sizeof (float));
+      theOut.Put<uint16_t> (0);
+    }
+  }
+
+  // Wavefront OBJ, one based indices. Nine digits so floats read back exact.
+  void EncodeOBJ (const MeshBuffer& theMesh, ByteWriter& theOut)
+  {
+    theOut.Print ("# created with Makertron Technology\n");
+    for (uint32_t i = 0; i < theMesh.nVertices; i++)
+    {
+      const float* aPos = theMesh.positions + 3 * i;
+      theOut.Print ("v %.9g %.9g %.9g\n", aPos[0], aPos[1], aPos[2]);
+    }
+    for (uint32_t iTri = 0; iTri < theMesh.nTriangles; iTri++)
+    {
+      const uint32_t* anIdx = theMesh.indices + 3 * iTri;
+      theOut.Print ("f %u %u %u\n", anIdx[0] + 1, anIdx[1] + 1, anIdx[2] + 1);
+    }
+  }
+
+  // Binary little endian PLY
+  void EncodePLY (const MeshBuffer& theMesh, ByteWriter& theOut)
+  {
+    theOut.Print ("ply\nformat binary_little_endian 1.0\n"
+                  "comment created with Makertron Technology\n");
+    theOut.Print ("element vertex %u\n", theMesh.nVertices);
+    theOut.Print ("property float x\nproperty float y\nproperty float z\n");
+    theOut.Print ("element face %u\n", theMesh.nTriangles);
+    theOut.Print ("property list uchar uint vertex_indices\nend_header\n");
+    theOut.Write (theMesh.positions, sizeof (float) * 3 * theMesh.nVertices);
+    for (uint32_t iTri = 0; iTri < theMesh.nTriangles; iTri++)
+    {
+      theOut.Put<uint8_t> (3);
+      theOut.Write (theMesh.indices + 3 * iTri, 3 * sizeof (uint32_t));
+    }
+  }
+
+  // Encodes a mesh in one of the MeshFormat file formats
+  bool EncodeMesh (const MeshBuffer& theMesh, int theFormat, ByteWriter& theOut)
+  {
+    switch (theFormat)
+    {
+      case MESH_FORMAT_STL: EncodeSTL (theMesh, theOut); break;
+      case MESH_FORMAT_OBJ: EncodeOBJ (theMesh, theOut); break;
+      case MESH_FORMAT_PLY: EncodePLY (theMesh, theOut); break;
+      default: return false;
+    }
+    return !theOut.Failed();
+  }
+
+  // Gives the triangulation nodes of every face a vertex id shared across
+  // faces. Nodes lying on an edge are matched through the edge polygons on
+  // the triangulations of the faces meeting there, and edge end nodes through
+  // the topological vertices, so the faces come out as one closed mesh.
+  // Positions are kept as Real, float for export and double for geometry.
+  template <typename Real>
+  class MeshWelder
+  {
+  public:
+    MeshWelder (std::vector<Real>& thePositions, std::vector<uint32_t>& theIndices)
+    : myPositions (thePositions), myIndices (theIndices) {}
+
+    void AddFace (const TopoDS_Face& theFace)
+    {
+      TriangleAccessor aTool (theFace);
+      if (aTool.NbTriangles() == 0)
+        return;
+
+      const uint32_t anUnset = UINT32_MAX;
+      std::vector<uint32_t> anIds (aTool.NbNodes() + 1, anUnset);
+      for (TopExp_Explorer exp (theFace, TopAbs_EDGE); exp.More(); exp.Next())
+      {
+        const TopoDS_Edge& anEdge = TopoDS::Edge (exp.Current());
+        Handle(Poly_PolygonOnTriangulation) aPoly = aTool.EdgePolygon (anEdge);
+        if (aPoly.IsNull())
+          continue;
+        const TColStd_Array1OfInteger& aNodes = aPoly->Nodes();
+        TopoDS_Vertex aV1, aV2;
+        TopExp::Vertices (anEdge, aV1, aV2);
+
+        // all nodes of a collapsed edge sit on its vertex
+        if (BRep_Tool::Degenerated (anEdge))
+        {
+          for (int i = aNodes.Lower(); i <= aNodes.Upper(); i++)
+            anIds[aNodes(i)] = vertexId (aV1, aTool.GetNode (aNodes(i)));
+          continue;
+        }
+
+        // polygon runs along the edge parameter, first node on the first vertex
+        const int aFirst = aNodes.Lower(), aLast = aNodes.Upper();
+        anIds[aNodes(aFirst)] = vertexId (aV1, aTool.GetNode (aNodes(aFirst)));
+        anIds[aNodes(aLast)]  = vertexId (aV2, aTool.GetNode (aNodes(aLast)));
+
+        // inner nodes reuse the ids of a face already sharing this edge, also
+        // covering both sides of a seam within the one face
+        std::vector<uint32_t>* aShared = myEdges.ChangeSeek (anEdge);
+        if (aShared != NULL && (int )aShared->size() == aNodes.Length())
+        {
+          for (int i = aFirst + 1; i < aLast; i++)
+            anIds[aNodes(i)] = (*aShared)[i - aFirst];
+          continue;
+        }
+        std::vector<uint32_t> anEdgeIds (aNodes.Length());
+        anEdgeIds.front() = anIds[aNodes(aFirst)];
+        anEdgeIds.back()  = anIds[aNodes(aLast)];
+        for (int i = aFirst + 1; i < aLast; i++)
+        {
+          if (anIds[aNodes(i)] == anUnset)
+            anIds[aNodes(i)] = newVertex (aTool.GetNode (aNodes(i)));
+          anEdgeIds[i - aFirst] = anIds[aNodes(i)];
+        }
+        if (aShared == NULL)
+          myEdges.Bind (anEdge, anEdgeIds);
+      }
+
+      // face interior
+      for (int iNode = 1; iNode <= aTool.NbNodes(); iNode++)
+      {
+        if (anIds[iNode] == anUnset)
+          anIds[iNode] = newVertex (aTool.GetNode (iNode));
+      }
+
+      // triangles collapsed on to a pole by welding are dropped
+      for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
+      {
+        int iNode1, iNode2, iNode3;
+        aTool.GetTriangleNodes (iTri, iNode1, iNode2, iNode3);
+        const uint32_t a = anIds[iNode1], b = anIds[iNode2], c = anIds[iNode3];
+        if (a == b || b == c || c == a)
+          continue;
+        myIndices.push_back (a);
+        myIndices.push_back (b);
+        myIndices.push_back (c);
+      }
+    }
+
+  private:
+    uint32_t newVertex (const gp_Pnt& thePnt)
+    {
+      myPositions.push_back ((Real )thePnt.X());
+      myPositions.push_back ((Real )thePnt.Y());
+      myPositions.push_back ((Real )thePnt.Z());
+      return (uint32_t )(myPositions.size() / 3 - 1);
+    }
+
+    uint32_t vertexId (const TopoDS_Vertex& theVertex, const gp_Pnt& thePnt)
+    {
+      if (theVertex.IsNull())
+        return newVertex (thePnt);
+      const uint32_t* anId = myVertices.Seek (theVertex);
+      if (anId != NULL)
+        return *anId;
+      const uint32_t aNew = newVertex (thePnt);
+      myVertices.Bind (theVertex, aNew);
+      return aNew;
+    }
+
+  private:
+    std::vector<Real>&     myPositions;
+    std::vector<uint32_t>& myIndices;
+    NCollection_DataMap<TopoDS_Shape, uint32_t, TopTools_ShapeMapHasher> myVertices;
+    NCollection_DataMap<TopoDS_Shape, std::vector<uint32_t>, TopTools_ShapeMapHasher> myEdges;
+  };
+
+}
+
+ReadWrite::ReadWrite() : myParallel(true) {
 }
 
-ReadWrite::ReadWrite() {
+// Switch threaded meshing and triangle extraction on or off 
+void ReadWrite::SetParallel(bool parallel) {
+	myParallel = parallel; 
 }
 
 // Write BREP 
@@ -138,54 +828,517 @@ TopoDS_Shape ReadWrite::ReadBREP(std::string brep)
 		//std::cout << "Reading BREP" << std::endl; 
 		BRep_Builder brepb;
 
-		std::stringstream stream;
+		MemoryStreamBuf buffer( brep.data() , brep.size() ); 
+		std::istream stream( &buffer );
 		TopoDS_Shape shape;
-		stream << brep << std::endl; 
     BRepTools::Read(shape,stream,brepb);		
 		return shape; 
 }
 
-// Write as STL
-void ReadWrite::WriteSTL(const TopoDS_Shape& shape)
+// Keep translated STEP and IGES imports as binary BREP files in this 
+// directory as well as in memory, so they survive restarts 
+void ReadWrite::SetImportCache(const char* dir)
 {
-    StlAPI_Writer stl_writer;
-		BRepMesh_IncrementalMesh ( shape, 0.01);	
-    stl_writer.Write(shape, "demo1.stl");		
+	myImportCache = dir == NULL ? "" : dir; 
+}
+
+// Key for an import, made from a hash of the file contents ( 64 bit FNV-1a ) 
+// and its size so the same part found under another name is still a hit 
+bool ReadWrite::importKey(const char* path,const char* format,std::string& key)
+{
+	FILE* file = fopen( path , "rb" ); 
+	if ( file == NULL ) { 
+		PRINT( std::string("Failed to open ") + path ); 
+		return false; 
+	}
+	uint64_t hash = 14695981039346656037ULL; 
+	uint64_t size = 0; 
+	std::vector<unsigned char> block( FILE_FLUSH_BYTES ); 
+	size_t got; 
+	while ( ( got = fread( &block[0] , 1 , block.size() , file ) ) > 0 ) { 
+		for ( size_t i = 0; i < got; i++ ) { 
+			hash ^= block[i]; 
+			hash *= 1099511628211ULL; 
+		}
+		size += got; 
+	}
+	fclose( file ); 
+	char name[64]; 
+	snprintf( name , sizeof(name) , "%016llx-%llx.%s" , (unsigned long long)hash , (unsigned long long)size , format ); 
+	key = name; 
+	return true; 
+}
+
+// Translated imports kept in memory, dropped all at once when full 
+static const size_t IMPORT_CACHE_ENTRIES = 256; 
+
+// Look an import up in memory, then on disk 
+bool ReadWrite::cachedImport(const std::string& key,TopoDS_Shape& shape)
+{
+	std::map<std::string,TopoDS_Shape>::const_iterator it = myImports.find( key ); 
+	if ( it != myImports.end() ) { 
+		shape = it->second; 
+		return true; 
+	}
+	if ( myImportCache.empty() ) return false; 
+	std::string path = myImportCache + "/" + key + ".bbrep"; 
+	try { 
+		TopoDS_Shape loaded; 
+		if ( BinTools::Read( loaded , path.c_str() ) && !loaded.IsNull() ) { 
+			if ( myImports.size() >= IMPORT_CACHE_ENTRIES ) myImports.clear(); 
+			myImports[key] = loaded; 
+			shape = loaded; 
+			return true; 
+		}
+	}
+	catch(...) { 
+		PRINT( std::string("Ignoring unreadable import cache ") + path ); 
+	}
+	return false; 
+}
+
+// Remember a translated import in memory and on disk 
+void ReadWrite::cacheImport(const std::string& key,const TopoDS_Shape& shape)
+{
+	if ( myImports.size() >= IMPORT_CACHE_ENTRIES ) myImports.clear(); 
+	myImports[key] = shape; 
+	if ( myImportCache.empty() ) return; 
+	std::string path = myImportCache + "/" + key + ".bbrep"; 
+	if ( !BinTools::Write( shape , path.c_str() ) ) PRINT( std::string("Failed to write import cache ") + path ); 
+}
+
+// Import a STEP file. The file is parsed once and its roots translated in 
+// turn, OCCT's STEP translation not being safe to run on several readers at 
+// once. A file with any root that fails is not cached, so a later import 
+// tries it again rather than keeping a part of it. 
+bool ReadWrite::ImportSTEP(const char* path,TopoDS_Shape& shape)
+{
+	std::string key; 
+	if ( !importKey( path , "step" , key ) ) return false; 
+	if ( cachedImport( key , shape ) ) return true; 
+	try { 
+		STEPControl_Reader reader; 
+		if ( reader.ReadFile( path ) != IFSelect_RetDone ) { 
+			PRINT( std::string("Failed to read STEP ") + path ); 
+			return false; 
+		}
+		int roots = reader.NbRootsForTransfer(); 
+		BRep_Builder builder; 
+		TopoDS_Compound compound; 
+		builder.MakeCompound( compound ); 
+		TopoDS_Shape single; 
+		int count = 0; 
+		int failed = 0; 
+		for ( int i = 1; i <= roots; i++ ) { 
+			try { 
+				// roots such as annotations transfer to no shape, which is not a failure 
+				const int before = reader.NbShapes(); 
+				bool transferred = reader.TransferRoot( i ); 
+				if ( reader.NbShapes() == before ) continue; 
+				if ( !transferred ) { 
+					failed++; 
+					continue; 
+				}
+				single = reader.Shape( reader.NbShapes() ); 
+				builder.Add( compound , single ); 
+				count++; 
+			}
+			catch(...) { 
+				failed++; 
+			}
+		}
+		if ( failed > 0 ) { 
+			std::stringstream output; 
+			output << "Failed to translate " << failed << " of " << roots << " roots in STEP " << path; 
+			PRINT( output.str() ); 
+			return false; 
+		}
+		if ( count == 0 ) { 
+			PRINT( std::string("No shapes in STEP ") + path ); 
+			return false; 
+		}
+		shape = count > 1 ? TopoDS_Shape( compound ) : single; 
+		cacheImport( key , shape ); 
+		return true; 
+	}
+	catch(...) { 
+		PRINT( std::string("Failed to translate STEP ") + path ); 
+	}
+	return false; 
+}
+
+// Import an IGES file. IGES roots refer in to a shared entity pool so they 
+// are translated together on one reader. 
+bool ReadWrite::ImportIGES(const char* path,TopoDS_Shape& shape)
+{
+	std::string key; 
+	if ( !importKey( path , "iges" , key ) ) return false; 
+	if ( cachedImport( key , shape ) ) return true; 
+	try { 
+		IGESControl_Reader reader; 
+		if ( reader.ReadFile( path ) != IFSelect_RetDone ) { 
+			PRINT( std::string("Failed to read IGES ") + path ); 
+			return false; 
+		}
+		reader.TransferRoots(); 
+		shape = reader.OneShape(); 
+		if ( shape.IsNull() ) { 
+			PRINT( std::string("No shapes in IGES ") + path ); 
+			return false; 
+		}
+		cacheImport( key , shape ); 
+		return true; 
+	}
+	catch(...) { 
+		PRINT( std::string("Failed to translate IGES ") + path ); 
+	}
+	return false; 
+}
+
+// Write BREP in the binary format in to a block handed over to the caller 
+bool ReadWrite::WriteBinBREP(const TopoDS_Shape& shape,Buffer* out)
+{
+	out->data = NULL; out->size = 0; 
+	try { 
+		ByteWriter writer; 
+		WriterStreamBuf buffer( writer ); 
+		std::ostream stream( &buffer ); 
+		BinTools::Write( shape , stream ); 
+		stream.flush(); 
+		if ( !stream || writer.Failed() ) { 
+			PRINT("Failed to write binary BREP"); 
+			return false; 
+		}
+		out->data = writer.Release( out->size ); 
+		return true; 
+	}
+	catch(...) { 
+		PRINT("Failed to write binary BREP"); 
+	}
+	return false; 
+}
+
+// Read BREP in the binary format straight out of the caller's memory 
+bool ReadWrite::ReadBinBREP(const void* data,size_t size,TopoDS_Shape& shape)
+{
+	try { 
+		MemoryStreamBuf buffer( data , size ); 
+		std::istream stream( &buffer ); 
+		BinTools::Read( shape , stream ); 
+		return !shape.IsNull(); 
+	}
+	catch(...) { 
+		PRINT("Failed to read binary BREP"); 
+	}
+	return false; 
+}
+
+// Write as binary STL to the given path at the given deflection 
+bool ReadWrite::WriteSTL(const TopoDS_Shape& shape,const char* path,float quality)
+{
+	Mesh( shape , quality ); 
+	return WriteMesh( shape , MESH_FORMAT_STL , path ); 
+}
+
+// Write an already meshed brep in one of the MeshFormat file formats to a 
+// block of memory handed over to the caller 
+bool ReadWrite::WriteMesh(const TopoDS_Shape& shape,int format,Buffer* out)
+{
+	out->data = NULL; out->size = 0; 
+	MeshBuffer mesh; 
+	if ( !ExportMesh( shape , &mesh , format != MESH_FORMAT_STL ) ) return false; 
+	ByteWriter writer; 
+	bool done = EncodeMesh( mesh , format , writer ); 
+	FreeMesh( &mesh ); 
+	if ( !done ) { 
+		PRINT("Failed to encode mesh"); 
+		return false; 
+	}
+	out->data = writer.Release( out->size ); 
+	return true; 
+}
+
+// Write an already meshed brep in one of the MeshFormat file formats to a path 
+bool ReadWrite::WriteMesh(const TopoDS_Shape& shape,int format,const char* path)
+{
+	FILE* file = fopen( path , "wb" ); 
+	if ( file == NULL ) { 
+		PRINT( std::string("Failed to open ") + path ); 
+		return false; 
+	}
+	MeshBuffer mesh; 
+	bool done = ExportMesh( shape , &mesh , format != MESH_FORMAT_STL ); 
+	if ( done ) { 
+		ByteWriter writer( file ); 
+		done = EncodeMesh( mesh , format , writer ); 
+		writer.Flush(); 
+		done = done && !writer.Failed(); 
+		FreeMesh( &mesh ); 
+	}
+	if ( fclose( file ) != 0 ) done = false; 
+	if ( !done ) { 
+		PRINT( std::string("Failed to write ") + path ); 
+		remove( path ); // no empty or partial file left behind 
+	}
+	return done; 
+}
+
+// Release a block handed out by WriteMesh 
+void ReadWrite::FreeBuffer(Buffer* buffer) 
+{
+	free( buffer->data ); buffer->data = NULL; buffer->size = 0; 
 }
 
 
 
 std::string  ReadWrite::Dump(const TopoDS_Shape& theShape)
 {
-	std::stringstream output;
-	output << "[";
-  for (TopExp_Explorer exp (theShape, TopAbs_FACE); exp.More(); exp.Next())
-  {
-   TriangleAccessor aTool (TopoDS::Face (exp.Current()));
-   for (int iTri = 1; iTri <= aTool.NbTriangles(); iTri++)
-   {
-     gp_Vec aNorm;
-     gp_Pnt aPnt1, aPnt2, aPnt3;
-     aTool.GetTriangle (iTri, aNorm, aPnt1, aPnt2, aPnt3);
-     output << aPnt1.X() << "," << aPnt1.Y() << "," << aPnt1.Z() << ",";
-     output << aPnt2.X() << "," << aPnt2.Y() << "," << aPnt2.Z() << ",";
-     output << aPnt3.X() << "," << aPnt3.Y() << "," << aPnt3.Z() << ",";
-   }
-  }
-  output << "0]\n"; 
-  return output.str(); 
+	// faces in explorer order so the output matches the serial walk 
+	std::vector<TopoDS_Face> faces; 
+	CollectFaces( theShape , faces ); 
+
+	// one buffer per run of faces, at most one run per logical processor 
+	int runs = myParallel ? OSD_Parallel::NbLogicalProcessors() : 1; 
+	if ( runs > (int)faces.size() ) runs = (int)faces.size(); 
+	if ( runs < 1 ) runs = 1; 
+	std::vector<std::string> buffers( runs ); 
+	OSD_Parallel::For( 0 , runs , FaceRunDumper( faces , buffers ) , !myParallel ); 
+
+	std::string output = "[";
+	for ( int i = 0; i < runs; i++ ) output += buffers[i]; 
+  output += "0]\n"; 
+  return output; 
 }
 
 
-// Write a brep out to an STL string 
-char* ReadWrite::ConvertBrepTostring(TopoDS_Shape brep,float quality) { 
+// Export an already meshed brep as an indexed float32 / uint32 mesh. 
+// Nodes are shared within each face, or across the whole shape if welded. 
+// Normals are split along face boundaries so they are only on offer for 
+// meshes that are not welded. 
+bool ReadWrite::ExportMesh(const TopoDS_Shape& theShape,MeshBuffer* out,bool weld,bool normals) 
+{
+	out->positions = NULL; out->nVertices = 0; 
+	out->indices = NULL; out->nTriangles = 0; 
+	out->normals = NULL; 
+
+	std::vector<TopoDS_Face> faces; 
+	CollectFaces( theShape , faces ); 
+
+	if ( weld ) { 
+		std::vector<float> positions; 
+		std::vector<uint32_t> indices; 
+		MeshWelder<float> welder( positions , indices ); 
+		for ( size_t i = 0; i < faces.size(); i++ ) welder.AddFace( faces[i] ); 
+		out->nVertices  = positions.size() / 3; 
+		out->nTriangles = indices.size() / 3; 
+		out->positions = (float*)malloc( sizeof(float) * positions.size() ); 
+		out->indices = (uint32_t*)malloc( sizeof(uint32_t) * indices.size() ); 
+		if ( ( out->nVertices && out->positions == NULL ) || ( out->nTriangles && out->indices == NULL ) ) { 
+			FreeMesh( out ); 
+			PRINT("Failed to allocate mesh buffer"); 
+			return false; 
+		}
+		if ( out->nVertices ) memcpy( out->positions , &positions[0] , sizeof(float) * positions.size() ); 
+		if ( out->nTriangles ) memcpy( out->indices , &indices[0] , sizeof(uint32_t) * indices.size() ); 
+		return true; 
+	}
+
+	// reserve a slot in the buffer for every face up front 
+	std::vector<uint32_t> nodeOffsets( faces.size() + 1 , 0 ); 
+	std::vector<uint32_t> triOffsets( faces.size() + 1 , 0 ); 
+	for ( size_t i = 0; i < faces.size(); i++ ) { 
+		TriangleAccessor aTool( faces[i] ); 
+		nodeOffsets[i+1] = nodeOffsets[i] + aTool.NbNodes(); 
+		triOffsets[i+1]  = triOffsets[i]  + aTool.NbTriangles(); 
+	}
+	out->nVertices  = nodeOffsets[faces.size()]; 
+	out->nTriangles = triOffsets[faces.size()]; 
+	out->positions = (float*)malloc( sizeof(float) * 3 * out->nVertices ); 
+	out->indices = (uint32_t*)malloc( sizeof(uint32_t) * 3 * out->nTriangles ); 
+	if ( normals ) out->normals = (float*)malloc( sizeof(float) * 3 * out->nVertices ); 
+	if ( ( out->nVertices && ( out->positions == NULL || ( normals && out->normals == NULL ) ) ) || ( out->nTriangles && out->indices == NULL ) ) { 
+		FreeMesh( out ); 
+		PRINT("Failed to allocate mesh buffer"); 
+		return false; 
+	}
+
+	OSD_Parallel::For( 0 , (int)faces.size() , FaceMeshWriter( faces , nodeOffsets , triOffsets , out ) , !myParallel ); 
+	return true; 
+}
+
+// Welded mesh of an already meshed brep at full precision, three doubles 
+// per vertex and three vertex indices per triangle. The faces share the 
+// nodes along their edges so a closed solid gives a closed mesh. 
+bool ReadWrite::WeldedMesh(const TopoDS_Shape& theShape,std::vector<double>& positions,std::vector<uint32_t>& indices) 
+{
+	positions.clear(); 
+	indices.clear(); 
+	try { 
+		std::vector<TopoDS_Face> faces; 
+		CollectFaces( theShape , faces ); 
+		MeshWelder<double> welder( positions , indices ); 
+		for ( size_t i = 0; i < faces.size(); i++ ) welder.AddFace( faces[i] ); 
+		return !indices.empty(); 
+	}
+	catch(...) { 
+		PRINT("Failed to weld mesh"); 
+	}
+	return false; 
+}
+
+// Release the arrays of a mesh buffer handed out by ExportMesh 
+void ReadWrite::FreeMesh(MeshBuffer* mesh) 
+{
+	free( mesh->positions ); mesh->positions = NULL; mesh->nVertices = 0; 
+	free( mesh->indices ); mesh->indices = NULL; mesh->nTriangles = 0; 
+	free( mesh->normals ); mesh->normals = NULL; 
+}
+
+// Deflection as a fraction of the bounding box diagonal, so small and large 
+// parts come out with a comparable number of triangles 
+float ReadWrite::RelativeDeflection(const TopoDS_Shape& shape,float relative) 
+{
+	return (float)( Diagonal( shape ) * relative ); 
+}
+
+// Deflection that brings the mesh of a shape close to a triangle budget. 
+// Trial meshes are run on a copy sharing the shape's geometry, starting 
+// coarse where they are cheap. Curved faces take roughly one triangle per 
+// unit of area / deflection so each trial rescales the deflection by how 
+// far it missed, which settles within a few rounds. Planar faces do not 
+// depend on deflection at all, a budget below what they need just ends 
+// up at the coarsest deflection tried. 
+float ReadWrite::BudgetDeflection(const TopoDS_Shape& shape,int triangles) 
+{
+	Standard_Real diagonal = Diagonal( shape ); 
+	if ( diagonal <= 0.0 || triangles <= 0 ) return 0.0; 
+	Standard_Real deflection = diagonal * 0.02; 
+	try { 
+		TopoDS_Shape work = BRepBuilderAPI_Copy( shape , Standard_False ).Shape(); 
+		for ( int i = 0; i < 4; i++ ) { 
+			BRepTools::Clean( work ); 
+			Mesh( work , (float)deflection ); 
+			int count = CountTriangles( work ); 
+			if ( count == 0 ) break; 
+			Standard_Real ratio = (Standard_Real)count / triangles; 
+			if ( ratio > 0.9 && ratio < 1.1 ) break; 
+			deflection = std::min( diagonal , std::max( diagonal * 1.0e-5 , deflection * ratio ) ); 
+		}
+	}
+	catch(...) { 
+		PRINT("Failed to fit mesh to triangle budget"); 
+	}
+	return (float)deflection; 
+}
+
+// Mesh a brep at several deflections in one go, coarsest first, handing each 
+// level to the callback as soon as it is meshed. Every level refines the 
+// triangulation the previous one left on the same topology. If the shape 
+// already carries a mesh finer than some level, the levels are built on a 
+// copy sharing its geometry so the cached triangulation is not thrown away. 
+// Returns the number of levels sent or -1 on failure. 
+int ReadWrite::ExportLods(const TopoDS_Shape& theShape,const float* deflections,int n,meshLodFP_t lod_cb,void* user,MeshState& state) 
+{
+	std::vector<int> order; 
+	for ( int i = 0; i < n; i++ ) { 
+		if ( deflections[i] > 0.0 ) order.push_back( i ); 
+	}
+	if ( order.empty() ) return 0; 
+	// coarsest first 
+	for ( size_t i = 1; i < order.size(); i++ ) { 
+		for ( size_t j = i; j > 0 && deflections[order[j]] > deflections[order[j-1]]; j-- ) std::swap( order[j] , order[j-1] ); 
+	}
+
+	try { 
+		bool inPlace = state.deflection <= 0.0 || state.deflection >= deflections[order[0]]; 
+		TopoDS_Shape work = theShape; 
+		if ( !inPlace ) work = BRepBuilderAPI_Copy( theShape , Standard_False ).Shape(); 
+		int sent = 0; 
+		for ( size_t i = 0; i < order.size(); i++ ) { 
+			if ( inPlace ) Mesh( work , deflections[order[i]] , state ); 
+			else Mesh( work , deflections[order[i]] ); 
+			MeshBuffer level; 
+			if ( !ExportMesh( work , &level ) ) return -1; 
+			(*lod_cb)( order[i] , &level , user ); 
+			FreeMesh( &level ); 
+			sent++; 
+		}
+		return sent; 
+	}
+	catch(...) { 
+		PRINT("Failed to export levels of detail"); 
+	}
+	return -1; 
+}
+
+// Mesh and hand a brep over in fixed size binary chunks. Faces are meshed 
+// a group at a time on a worker thread while the chunks already cut are 
+// passed to the callback on the calling thread. Edges shared with faces of 
+// an earlier group keep the polygons meshed there so the groups still join 
+// up. Returns the number of triangles sent or -1 on failure. 
+int ReadWrite::StreamMesh(const TopoDS_Shape& theShape,float quality,meshChunkFP_t chunk_cb,void* user,MeshState* state) 
+{
+	std::vector<TopoDS_Face> faces; 
+	CollectFaces( theShape , faces ); 
+
+	// already meshed fine enough, only the dirty faces if any need doing 
+	bool meshed = state != NULL && state->deflection > 0.0 && quality >= state->deflection; 
+	if ( meshed ) Mesh( theShape , quality , *state ); 
+
+	ChunkQueue queue( MESH_CHUNK_QUEUE ); 
+	ChunkBuilder chunker( queue , MESH_CHUNK_TRIANGLES ); 
+	bool failed = false; 
+
+	std::thread producer( [&]() { 
+		try { 
+			BRep_Builder builder; 
+			for ( size_t first = 0; first < faces.size(); first += MESH_FACE_GROUP ) { 
+				size_t last = std::min( faces.size() , first + MESH_FACE_GROUP ); 
+				TopoDS_Compound group; 
+				builder.MakeCompound( group ); 
+				for ( size_t i = first; i < last; i++ ) builder.Add( group , faces[i] ); 
+				if ( !meshed ) Mesh( group , quality ); 
+				for ( size_t i = first; i < last; i++ ) chunker.AddFace( faces[i] ); 
+			}
+			chunker.Flush(); 
+		}
+		catch(...) { 
+			failed = true; 
+		}
+		queue.Close(); 
+	}); 
+
+	MeshChunk chunk; 
+	while ( queue.Pop( chunk ) ) { 
+		MeshBuffer out; 
+		out.positions  = chunk.Positions.empty() ? NULL : &chunk.Positions[0]; 
+		out.nVertices  = chunk.Positions.size() / 3; 
+		out.indices    = &chunk.Indices[0]; 
+		out.nTriangles = chunk.Indices.size() / 3; 
+		out.normals    = NULL; 
+		(*chunk_cb)( &out , user ); 
+	}
+	producer.join(); 
+
+	if ( failed ) { 
+		PRINT("Failed to stream mesh"); 
+		if ( state != NULL && !meshed ) *state = MeshState(); 
+		return -1; 
+	}
+	if ( state != NULL && !meshed ) { 
+		state->deflection = quality; 
+		state->angle = 0.5; 
+		state->dirty.Clear(); 
+	}
+	return (int)chunker.NbTriangles(); 
+}
+
+// Mesh a brep in place at the given linear and angular deflection 
+void ReadWrite::Mesh(const TopoDS_Shape& shape,float quality,float angle) { 
 
-	TopoDS_Shape shape = brep; 
-	StlAPI_Writer stl_writer;
-	
 	// Tolerances 
 	Standard_Real tolerance = quality;
-  Standard_Real angular_tolerance = 0.5;
+  Standard_Real angular_tolerance = angle;
   Standard_Real minTriangleSize = Precision::Confusion();
 
 	// Set the mesh tolerances 6.x and onwards .. ( standard distribution library ) useless as does not support setMinSize yet??
@@ -207,10 +1360,52 @@ char* ReadWrite::ConvertBrepTostring(TopoDS_Shape brep,float quality) {
   m_MeshParams.InternalVerticesMode = Standard_False;
   m_MeshParams.Relative=Standard_False;
   m_MeshParams.Angle = angular_tolerance;
+  m_MeshParams.InParallel = myParallel; 
 	BRepMesh_IncrementalMesh ( shape, m_MeshParams );
+}
 
+// Mesh a brep unless the state says its triangulations are already at the 
+// requested quality or finer. Faces left dirty by a boolean are meshed on 
+// their own at the deflection the kept faces have, so the edges they share 
+// reuse the polygons already there. 
+void ReadWrite::Mesh(const TopoDS_Shape& shape,float quality,MeshState& state) { 
+	const float angle = 0.5; 
+	if ( state.deflection > 0.0 && quality >= state.deflection && angle >= state.angle ) { 
+		if ( state.dirty.IsEmpty() ) return; 
+		BRep_Builder builder; 
+		TopoDS_Compound dirty; 
+		builder.MakeCompound( dirty ); 
+		for ( TopTools_ListIteratorOfListOfShape it( state.dirty ); it.More(); it.Next() ) builder.Add( dirty , it.Value() ); 
+		Mesh( dirty , state.deflection , state.angle ); 
+		state.dirty.Clear(); 
+		return; 
+	}
+	Mesh( shape , quality , angle ); 
+	state.deflection = quality; 
+	state.angle = angle; 
+	state.dirty.Clear(); 
+}
+
+// Mesh a brep at exactly the given quality rather than at least it. A shape 
+// already carrying a finer mesh is left alone and a copy sharing its geometry 
+// is meshed instead. Returns whichever of the two carries the mesh. 
+TopoDS_Shape ReadWrite::MeshExact(const TopoDS_Shape& shape,float quality,MeshState& state) { 
+	if ( state.deflection > 0.0 && state.deflection < quality ) { 
+		TopoDS_Shape copy = BRepBuilderAPI_Copy( shape , Standard_False ).Shape(); 
+		Mesh( copy , quality ); 
+		return copy; 
+	}
+	Mesh( shape , quality , state ); 
+	return shape; 
+}
+
+// Write a brep out to an STL string 
+char* ReadWrite::ConvertBrepTostring(TopoDS_Shape brep,float quality,MeshState* state) { 
+
+	TopoDS_Shape shape = brep; 
+	if ( state != NULL ) Mesh( shape , quality , *state ); 
+	else Mesh( shape , quality ); 
 		
 	char *new_buf = strdup((char*)Dump(shape).c_str());			
   return new_buf; 
 }
-
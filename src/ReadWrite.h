@@ -21,6 +21,13 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <MeshBuffer.h>
+#include <MeshState.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
 class TopoDS_Shape;
 
 using namespace std;
@@ -31,12 +38,38 @@ class ReadWrite {
 		Standard_EXPORT ReadWrite();
 		Standard_EXPORT std::string  WriteBREP(const TopoDS_Shape& shape);
 		Standard_EXPORT TopoDS_Shape ReadBREP(std::string brep);
+		Standard_EXPORT bool  WriteBinBREP(const TopoDS_Shape& shape,Buffer* out);
+		Standard_EXPORT bool  ReadBinBREP(const void* data,size_t size,TopoDS_Shape& shape);
 		Standard_EXPORT std::string  Dump(const TopoDS_Shape& theShape);
-		Standard_EXPORT void  WriteSTL(const TopoDS_Shape& shape);
-		Standard_EXPORT char* ConvertBrepTostring(TopoDS_Shape brep,float quality);
+		Standard_EXPORT bool  WriteSTL(const TopoDS_Shape& shape,const char* path,float quality);
+		Standard_EXPORT bool  WriteMesh(const TopoDS_Shape& shape,int format,Buffer* out);
+		Standard_EXPORT bool  WriteMesh(const TopoDS_Shape& shape,int format,const char* path);
+		Standard_EXPORT static void FreeBuffer(Buffer* buffer);
+		Standard_EXPORT char* ConvertBrepTostring(TopoDS_Shape brep,float quality,MeshState* state = NULL);
+		Standard_EXPORT void  Mesh(const TopoDS_Shape& shape,float quality,float angle = 0.5);
+		Standard_EXPORT void  Mesh(const TopoDS_Shape& shape,float quality,MeshState& state);
+		Standard_EXPORT TopoDS_Shape MeshExact(const TopoDS_Shape& shape,float quality,MeshState& state);
+		Standard_EXPORT void  SetParallel(bool parallel);
+		Standard_EXPORT void  SetImportCache(const char* dir);
+		Standard_EXPORT bool  ImportSTEP(const char* path,TopoDS_Shape& shape);
+		Standard_EXPORT bool  ImportIGES(const char* path,TopoDS_Shape& shape);
+		Standard_EXPORT float RelativeDeflection(const TopoDS_Shape& shape,float relative);
+		Standard_EXPORT float BudgetDeflection(const TopoDS_Shape& shape,int triangles);
+		Standard_EXPORT bool  ExportMesh(const TopoDS_Shape& theShape,MeshBuffer* out,bool weld = false,bool normals = false);
+		Standard_EXPORT static void FreeMesh(MeshBuffer* mesh);
+		Standard_EXPORT bool  WeldedMesh(const TopoDS_Shape& theShape,std::vector<double>& positions,std::vector<uint32_t>& indices);
+		Standard_EXPORT int   ExportLods(const TopoDS_Shape& theShape,const float* deflections,int n,meshLodFP_t lod_cb,void* user,MeshState& state);
+		Standard_EXPORT int   StreamMesh(const TopoDS_Shape& theShape,float quality,meshChunkFP_t chunk_cb,void* user,MeshState* state = NULL);
 
 	protected:
 
 	private:
+		bool myParallel; // mesh faces and extract triangles across threads
+		std::string myImportCache; // directory translated imports are kept in, empty for none 
+		std::map<std::string,TopoDS_Shape> myImports; // translated imports by content key 
+
+		bool importKey(const char* path,const char* format,std::string& key);
+		bool cachedImport(const std::string& key,TopoDS_Shape& shape);
+		void cacheImport(const std::string& key,const TopoDS_Shape& shape);
 
 };
@@ -116,49 +116,267 @@ extern "C" int   ffi_circle(float r1);
 extern "C" int   ffi_extrude(float h1, int indexA);
 extern "C" int   ffi_cylinder(float r1,float h,float z);
 extern "C" int   ffi_minkowski(int indexA, int indexB);
+extern "C" int   ffi_hull(int* indices, int n);
 extern "C" char* ffi_convert_brep_tostring(int indexA,float quality);
+extern "C" int   ffi_set_parallel(int enabled);
+extern "C" int   ffi_export_mesh(int indexA,float quality,MeshBuffer* out);
+extern "C" int   ffi_export_mesh_normals(int indexA,float quality,MeshBuffer* out);
+extern "C" int   ffi_export_mesh_welded(int indexA,float quality,MeshBuffer* out);
+extern "C" int   ffi_export_mesh_relative(int indexA,float relative,MeshBuffer* out);
+extern "C" int   ffi_export_mesh_budget(int indexA,int triangles,MeshBuffer* out);
+extern "C" void  ffi_free_mesh(MeshBuffer* mesh);
+extern "C" int   ffi_export_lods(int indexA,const float* deflections,int n,meshLodFP_t lod_cb,void* user);
+extern "C" int   ffi_export_mesh_stream(int indexA,float quality,meshChunkFP_t chunk_cb,void* user);
+extern "C" void  ffi_free_string(char* str);
+extern "C" int   ffi_export_file(int indexA,float quality,int format,const char* path);
+extern "C" int   ffi_export_buffer(int indexA,float quality,int format,Buffer* out);
+extern "C" void  ffi_free_buffer(Buffer* buffer);
+extern "C" int   ffi_export_brep(int indexA,Buffer* out);
+extern "C" int   ffi_import_brep(const void* data,size_t size);
+extern "C" int   ffi_import_step(const char* path);
+extern "C" int   ffi_import_iges(const char* path);
+extern "C" int   ffi_set_import_cache(const char* dir);
+extern "C" int   ffi_set_decomposition_cache(const char* dir);
+extern "C" int   ffi_set_minkowski_preview(int max_parts,float concavity);
+extern "C" int   ffi_set_snap_grid(float grid);
+extern "C" int   ffi_snapshot_save(const char* path);
+extern "C" int   ffi_snapshot_load(const char* path);
 extern "C" int   ffi_cleanup(); 
 
-int ffi_cleanup() { geometry.shapeStack.clear(); }
+int ffi_cleanup() { geometry.clear(); }
+
+// Set while ffi_export_lods or ffi_export_mesh_stream is running. Their 
+// callbacks run while shapes shared across the stack are being meshed, so 
+// they must not call back in to the library; calls that mesh refuse. 
+static bool meshCallbacks = false; 
+
+static bool reentered() { 
+	if ( meshCallbacks ) PRINT("Mesh callbacks must not call back in to the library"); 
+	return meshCallbacks; 
+}
+
+// STEP part, translated once per file contents, returns its index or -1 
+int ffi_import_step(const char* path) { 
+	TopoDS_Shape shape_a; 
+	if ( !readwrite.ImportSTEP( path , shape_a ) ) return -1; 
+	geometry.add( shape_a ); 
+	return geometry.currentIndex(); 
+}
+
+// IGES part, translated once per file contents, returns its index or -1 
+int ffi_import_iges(const char* path) { 
+	TopoDS_Shape shape_a; 
+	if ( !readwrite.ImportIGES( path , shape_a ) ) return -1; 
+	geometry.add( shape_a ); 
+	return geometry.currentIndex(); 
+}
+
+// directory to keep translated imports in across sessions, NULL for memory only 
+int ffi_set_import_cache(const char* dir) { 
+	readwrite.SetImportCache( dir ); 
+	return 0; 
+}
+
+// directory to keep minkowski convex decompositions in across sessions, NULL for memory only 
+int ffi_set_decomposition_cache(const char* dir) { 
+	BrepCgal::SetDecompositionCache( dir ); 
+	return 0; 
+}
+
+// preview minkowski: decompose operands approximately in to at most max_parts 
+// parts within concavity ( relative to their size ), 0 parts for exact 
+int ffi_set_minkowski_preview(int max_parts,float concavity) { 
+	BrepCgal::SetApproximate( max_parts , concavity ); 
+	return 0; 
+}
+
+// grid exact minkowski rounds operand coordinates to before decomposing, 0 ( the default ) to leave them as they are 
+int ffi_set_snap_grid(float grid) { 
+	BrepCgal::SetSnapGrid( grid ); 
+	return 0; 
+}
+
+// save the whole shape stack to a file, returns the number of entries or -1 
+int ffi_snapshot_save(const char* path) { 
+	if ( !geometry.save( path ) ) return -1; 
+	return geometry.currentIndex() + 1; 
+}
+
+// replace the shape stack with a saved one, returns the number of entries or -1 
+int ffi_snapshot_load(const char* path) { 
+	return geometry.load( path ); 
+}
+
+// switch threaded meshing and triangle extraction on ( default ) or off 
+int ffi_set_parallel(int enabled) { 
+	readwrite.SetParallel( enabled != 0 ); 
+	return enabled; 
+}
 
 char* ffi_convert_brep_tostring(int indexA,float quality) {
+	if ( reentered() ) return NULL; 
 	TopoDS_Shape brep; 
 	geometry.get( indexA , brep );  
-	return readwrite.ConvertBrepTostring(brep,quality);
+	return readwrite.ConvertBrepTostring(brep,quality,&geometry.meshState(indexA));
 } 
 
+// release a string handed out by ffi_convert_brep_tostring 
+void ffi_free_string(char* str) { 
+	free( str ); 
+}
+
+// indexed binary mesh, returns the triangle count or -1 on failure 
+int ffi_export_mesh(int indexA,float quality,MeshBuffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	readwrite.Mesh( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.ExportMesh( brep , out ) ) return -1; 
+	return out->nTriangles; 
+}
+
+// indexed binary mesh with a surface normal per vertex, split at face boundaries 
+int ffi_export_mesh_normals(int indexA,float quality,MeshBuffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	readwrite.Mesh( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.ExportMesh( brep , out , false , true ) ) return -1; 
+	return out->nTriangles; 
+}
+
+// as above but with vertices welded across faces in to one closed mesh 
+int ffi_export_mesh_welded(int indexA,float quality,MeshBuffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	readwrite.Mesh( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.ExportMesh( brep , out , true ) ) return -1; 
+	return out->nTriangles; 
+}
+
+// indexed binary mesh at a deflection relative to the bounding box diagonal 
+int ffi_export_mesh_relative(int indexA,float relative,MeshBuffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	float quality = readwrite.RelativeDeflection( brep , relative ); 
+	if ( quality <= 0.0 ) return -1; 
+	brep = readwrite.MeshExact( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.ExportMesh( brep , out ) ) return -1; 
+	return out->nTriangles; 
+}
+
+// indexed binary mesh at whatever deflection lands near a triangle budget 
+int ffi_export_mesh_budget(int indexA,int triangles,MeshBuffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	float quality = readwrite.BudgetDeflection( brep , triangles ); 
+	if ( quality <= 0.0 ) return -1; 
+	brep = readwrite.MeshExact( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.ExportMesh( brep , out ) ) return -1; 
+	return out->nTriangles; 
+}
+
+void ffi_free_mesh(MeshBuffer* mesh) { 
+	readwrite.FreeMesh( mesh ); 
+}
+
+// several levels of detail in one call, coarsest handed over first 
+int ffi_export_lods(int indexA,const float* deflections,int n,meshLodFP_t lod_cb,void* user) { 
+	if ( lod_cb == NULL || deflections == NULL || reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	if ( !geometry.get( indexA , brep ) ) return -1; 
+	meshCallbacks = true; 
+	int sent = readwrite.ExportLods( brep , deflections , n , lod_cb , user , geometry.meshState( indexA ) ); 
+	meshCallbacks = false; 
+	return sent; 
+}
+
+// indexed binary mesh handed over chunk by chunk while it is being built 
+int ffi_export_mesh_stream(int indexA,float quality,meshChunkFP_t chunk_cb,void* user) { 
+	if ( chunk_cb == NULL || reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	if ( !geometry.get( indexA , brep ) ) return -1; 
+	meshCallbacks = true; 
+	int sent = readwrite.StreamMesh( brep , quality , chunk_cb , user , &geometry.meshState( indexA ) ); 
+	meshCallbacks = false; 
+	return sent; 
+}
+
+// write a mesh file ( MeshFormat ) to a path, returns 0 or -1 on failure 
+int ffi_export_file(int indexA,float quality,int format,const char* path) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	readwrite.Mesh( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.WriteMesh( brep , format , path ) ) return -1; 
+	return 0; 
+}
+
+// write a mesh file ( MeshFormat ) in to memory, returns its size or -1 
+int ffi_export_buffer(int indexA,float quality,int format,Buffer* out) { 
+	if ( reentered() ) return -1; 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	readwrite.Mesh( brep , quality , geometry.meshState( indexA ) ); 
+	if ( !readwrite.WriteMesh( brep , format , out ) ) return -1; 
+	return (int)out->size; 
+}
+
+void ffi_free_buffer(Buffer* buffer) { 
+	readwrite.FreeBuffer( buffer ); 
+}
+
+// exact shape in the binary BREP format, returns its size or -1 
+int ffi_export_brep(int indexA,Buffer* out) { 
+	TopoDS_Shape brep; 
+	geometry.get( indexA , brep );  
+	if ( !readwrite.WriteBinBREP( brep , out ) ) return -1; 
+	return (int)out->size; 
+}
+
+// exact shape from a binary BREP in the caller's memory, returns its index or -1 
+int ffi_import_brep(const void* data,size_t size) { 
+	TopoDS_Shape shape_a; 
+	if ( !readwrite.ReadBinBREP( data , size , shape_a ) ) return -1; 
+	geometry.add( shape_a ); 
+	return geometry.currentIndex(); 
+}
+
 int ffi_sphere(float radius, float x , float y , float z ) { 
 	TopoDS_Shape shape_a; 
 	geometry.sphere( radius , x , y , z , shape_a ); 
-	geometry.add( shape_a ); 
+	geometry.add( shape_a , ShapeInfo( SHAPE_SPHERE , radius ) ); 
 	return geometry.currentIndex(); 
 }
 
 int ffi_cube(float x , float y , float z , float xs , float ys , float zs) { 
 	TopoDS_Shape shape_a; 
 	geometry.cube( x , y , z , xs , ys , zs , shape_a ); 
-	geometry.add( shape_a ); 
+	geometry.add( shape_a , ShapeInfo( SHAPE_CUBE , 0.0 ) ); 
 	return geometry.currentIndex(); 
 }
 
 int ffi_cylinder(float r1,float h,float z) { 
 	TopoDS_Shape shape_a; 
 	geometry.cylinder( r1 , h , z , shape_a ); 
-	geometry.add( shape_a ); 
+	geometry.add( shape_a , ShapeInfo( SHAPE_CYLINDER , r1 ) ); 
 	return geometry.currentIndex(); 
 }
 
 int ffi_circle(float r1) { 
 	TopoDS_Shape shape_a; 
 	geometry.circle( r1 ,shape_a ); 
-	geometry.add( shape_a ); 
+	geometry.add( shape_a , ShapeInfo( SHAPE_CIRCLE , r1 ) ); 
 	return geometry.currentIndex(); 
 }
 
 int ffi_cone(float r1,float r2,float h,float z) { 
 	TopoDS_Shape shape_a; 
 	geometry.cone( r1 , r2 , h , z , shape_a ); 
-	geometry.add( shape_a ); 
+	geometry.add( shape_a , ShapeInfo( SHAPE_CONE , 0.0 ) ); 
 	return geometry.currentIndex(); 
 }
 
@@ -174,8 +392,9 @@ int ffi_difference(int indexA, int indexB) {
 	TopoDS_Shape shape_b;
 	geometry.get( indexA , shape_a ); 
 	geometry.get( indexB , shape_b ); 
-	geometry.difference( shape_a , shape_b ); 
-	geometry.set( indexA , shape_a ); 
+	MeshState state = geometry.combined( indexA , indexB ); 
+	geometry.difference( shape_a , shape_b , &state ); 
+	geometry.set( indexA , shape_a , state ); 
 	return indexA; 
 }
 
@@ -184,8 +403,9 @@ int ffi_union(int indexA, int indexB) {
 	TopoDS_Shape shape_b;
 	geometry.get( indexA , shape_a ); 
 	geometry.get( indexB , shape_b ); 
-	geometry.uni( shape_a , shape_b ); 
-	geometry.set( indexA , shape_a ); 
+	MeshState state = geometry.combined( indexA , indexB ); 
+	geometry.uni( shape_a , shape_b , &state ); 
+	geometry.set( indexA , shape_a , state ); 
 	return indexA; 
 }
 
@@ -194,8 +414,9 @@ int ffi_intersection(int indexA, int indexB) {
 	TopoDS_Shape shape_b;
 	geometry.get( indexA , shape_a ); 
 	geometry.get( indexB , shape_b ); 
-	geometry.intersection( shape_a , shape_b ); 
-	geometry.set( indexA , shape_a ); 
+	MeshState state = geometry.combined( indexA , indexB ); 
+	geometry.intersection( shape_a , shape_b , &state ); 
+	geometry.set( indexA , shape_a , state , geometry.convexIf( indexA , indexB ) ); 
 	return indexA; 
 }
 
@@ -203,7 +424,7 @@ int ffi_translate(float x , float y , float z , int indexA) {
 	TopoDS_Shape shape_a; 
 	geometry.get( indexA , shape_a ); 
 	geometry.translate( x , y , z , shape_a  ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.set( indexA , shape_a , geometry.meshState( indexA ) , geometry.shapeInfo( indexA ).translated( x , y , z ) ); 
 	return indexA; 
 }
 
@@ -211,7 +432,7 @@ int ffi_scale(float x , float y , float z , int indexA) {
 	TopoDS_Shape shape_a; 
 	geometry.get( indexA , shape_a ); 
 	geometry.scale( x , y , z , shape_a  ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.set( indexA , shape_a , MeshState() , geometry.shapeInfo( indexA ).scaled( x , y , z ) ); 
 	return indexA; 
 }
 
@@ -219,7 +440,7 @@ int ffi_rotateX(float x , int indexA) {
 	TopoDS_Shape shape_a; 
 	geometry.get( indexA , shape_a ); 
 	geometry.rotateX( x , shape_a  ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.set( indexA , shape_a , geometry.meshState( indexA ) , geometry.shapeInfo( indexA ).rotated( gp::OX() , x ) ); 
 	return indexA; 
 }
 
@@ -227,7 +448,7 @@ int ffi_rotateY(float y , int indexA) {
 	TopoDS_Shape shape_a; 
 	geometry.get( indexA , shape_a ); 
 	geometry.rotateY( y , shape_a  ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.set( indexA , shape_a , geometry.meshState( indexA ) , geometry.shapeInfo( indexA ).rotated( gp::OY() , y ) ); 
 	return indexA; 
 }
 
@@ -235,7 +456,7 @@ int ffi_rotateZ(float z , int indexA) {
 	TopoDS_Shape shape_a; 
 	geometry.get( indexA , shape_a ); 
 	geometry.rotateZ( z , shape_a  ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.set( indexA , shape_a , geometry.meshState( indexA ) , geometry.shapeInfo( indexA ).rotated( gp::OZ() , z ) ); 
 	return indexA; 
 }
 
@@ -249,15 +470,30 @@ int ffi_extrude(float h1, int indexA) {
 
 // ffi hook for minkowski
 int ffi_minkowski(int indexA , int indexB ) { 
+	if ( reentered() ) return -1; 
 	TopoDS_Shape shape_a; 
 	TopoDS_Shape shape_b;
 	geometry.get( indexA , shape_a ); 
 	geometry.get( indexB , shape_b ); 
-	geometry.minkowski( shape_a , shape_b ); 
-	geometry.set( indexA , shape_a ); 
+	geometry.minkowski( shape_a , shape_b , &geometry.shapeInfo( indexA ) , &geometry.shapeInfo( indexB ) ); 
+	geometry.set( indexA , shape_a , MeshState() , geometry.convexIf( indexA , indexB ) ); 
 	return indexA; 
 }
 
+// convex hull of n shapes, left in the first of them 
+int ffi_hull(int* indices , int n ) { 
+	if ( reentered() ) return -1; 
+	if ( indices == NULL || n <= 0 ) return -1; 
+	std::vector<TopoDS_Shape> shapes( n ); 
+	for ( int i = 0; i < n; i++ ) if ( !geometry.get( indices[i] , shapes[i] ) ) return -1; 
+	TopoDS_Shape shape_a; 
+	if ( !geometry.hull( &shapes[0] , n , shape_a ) ) return -1; 
+	ShapeInfo info; 
+	info.convex = true; 
+	geometry.set( indices[0] , shape_a , MeshState() , info ); 
+	return indices[0]; 
+}
+
 #ifdef DEBUG
 	int main() { 
 	